@@ -1,72 +1,145 @@
 #include "TrackingCommands.h"
 #include <algorithm>
-#include <QMessageBox>
 
 namespace Actions
 {
-	PerformAutomaticTrackingCommand::PerformAutomaticTrackingCommand(Data::Document& document, const QString& trackerType, const int roiSize) :
+	PerformAutomaticTrackingCommand::PerformAutomaticTrackingCommand(Data::Document& document, const QString& trackerType, const int roiSize, const int startFrame, const int endFrame, const bool parallelSegments, const int downscaleLevels, const int inferenceThreads,
+		const Tracking::MotionModelType motionModel, const bool cameraMotion) :
 		m_document(document),
-		m_points(),
-		m_params{ roiSize,  trackerType, document },
-		m_trackingManager(m_params),
-		m_timer()
+		m_backups(),
+		m_params{ roiSize, startFrame, endFrame, trackerType, document, parallelSegments, -1, downscaleLevels, inferenceThreads, motionModel, cameraMotion },
+		m_engine(m_params)
 	{
-		m_params.roiSize = roiSize;
-		m_params.trackerType = trackerType;
-		//m_params.startFrame = startFrame;
-		//m_params.endFrame = endFrame;
-
 		const QVector<int>& activePointsIndices = m_document.GetActivePointIndices();
 		std::for_each(activePointsIndices.cbegin(), activePointsIndices.cend(), [this](const int index)
 			{
 				const Data::TrackedPoint& trackedPoint = m_document.GetTrackedPoint(index);
-				m_points.emplace_back(trackedPoint.GetCopy());
+				m_backups.push_back({ index, trackedPoint.GetKeyframesInRange(m_params.startFrame, m_params.endFrame) });
+			});
+
+		// The engine lives in the GUI thread: its signals, emitted by the worker, are queued.
+		QObject::connect(&m_engine, &Tracking::TrackingEngine::ResultsAvailable, &m_engine, [this]
+			{
+				ApplyResults();
 			});
 	}
 
 	void PerformAutomaticTrackingCommand::redo()
 	{
-		m_trackingManager.InitializeTrackers();
+		// A tracking that could not start changed nothing: it must not be undoable, or its
+		// undo would rewrite the keyframes of the range. TrackingFailed tells the user why.
+		if (!m_engine.Start())
+			setObsolete(true);
+	}
 
-		m_timer.setInterval(16); // 60FPS max.
-		QTimer::connect(&m_timer, &QTimer::timeout, [this]
+	void PerformAutomaticTrackingCommand::undo()
+	{
+		// Results still queued are discarded along with the rest of the tracking.
+		m_engine.Cancel();
+		m_engine.Wait();
+		static_cast<void>(m_engine.TakeResults());
+
+		for (const PointBackup& backup : m_backups)
+		{
+			Data::TrackedPoint& realPoint = m_document.GetTrackedPoint(backup.pointIndex);
+			realPoint.RemoveKeyframesInRange(m_params.startFrame, m_params.endFrame);
+			for (const Data::Keyframe& keyframe : backup.keyframes)
 			{
-				Data::Video& video = m_document.GetVideo();
-
-				if (video.GetCurrentFrameIndex() + 1 < video.GetFrameCount())
-				{
-					try
-					{
-						m_trackingManager.TickTrackers();
-						video.ReadNextFrame();
-					}
-					catch (Tracking::TrackingException& ex)
-					{
-						QMessageBox messageBox;
-						messageBox.setWindowTitle("Tracking Error");
-						messageBox.setText(QString("An error occurred while tracking the points. ") + ex.what());
-						m_timer.stop();
-					}
-				}
-				else
-				{
-					m_timer.stop();
-				}
+				realPoint.AddKeyframe(keyframe);
+			}
+		}
+	}
+
+	Tracking::TrackingEngine& PerformAutomaticTrackingCommand::GetEngine()
+	{
+		return m_engine;
+	}
+
+	void PerformAutomaticTrackingCommand::ApplyResults()
+	{
+		const QVector<Tracking::TrackedFrame> results = m_engine.TakeResults();
+		if (results.isEmpty())
+			return;
+		m_engine.CommitResults(results);
+
+		// Display the frame the worker just decoded instead of decoding it again. There is
+		// none when the segments are tracked in parallel.
+		int frameIndex;
+		const cv::Mat image = m_engine.GetLastImage(frameIndex);
+		if (frameIndex >= 0)
+			m_document.GetVideo().ShowFrame(frameIndex, image);
+	}
+
+	RetrackPointCommand::RetrackPointCommand(Data::Document& document, const QString& trackerType, const int roiSize, const int pointIndex, const int correctedFrame, const int downscaleLevels, const int inferenceThreads,
+		const Tracking::MotionModelType motionModel, const bool cameraMotion) :
+		m_document(document),
+		m_pointIndex(pointIndex),
+		m_backup(),
+		m_backupEnd(document.GetTrackedPoint(pointIndex).GetTrackedRunEnd(correctedFrame)),
+		m_interrupted(false),
+		m_params{ roiSize, correctedFrame, document.GetVideo().GetFrameCount() - 1, trackerType, document, false, pointIndex, downscaleLevels, inferenceThreads, motionModel, cameraMotion },
+		m_engine(m_params)
+	{
+		m_backup = m_document.GetTrackedPoint(m_pointIndex).GetKeyframesInRange(correctedFrame + 1, m_backupEnd);
+		setText(QString("Re-track ") + m_document.GetTrackedPoint(m_pointIndex).GetName());
+
+		QObject::connect(&m_engine, &Tracking::TrackingEngine::ResultsAvailable, &m_engine, [this]
+			{
+				ApplyResults();
 			});
-		m_timer.start();
 	}
 
-	void PerformAutomaticTrackingCommand::undo()
+	void RetrackPointCommand::redo()
 	{
-		for (const std::unique_ptr<Data::TrackedPoint>& backupPoint : m_points)
+		m_interrupted = false;
+		if (!m_engine.Start())
+			setObsolete(true);
+	}
+
+	void RetrackPointCommand::undo()
+	{
+		m_engine.Cancel();
+		m_engine.Wait();
+		static_cast<void>(m_engine.TakeResults());
+
+		// Only the keyframes of this re-tracking are replaced: the manual keyframes placed
+		// in the run since are not on the undo stack, and would be lost for good.
+		Data::TrackedPoint& realPoint = m_document.GetTrackedPoint(m_pointIndex);
+		for (const Data::Keyframe& keyframe : realPoint.GetKeyframesInRange(m_params.startFrame + 1, m_backupEnd))
 		{
-			Data::TrackedPoint& realPoint = m_document.GetTrackedPoint(backupPoint->GetPointIndex());
-			realPoint.ClearKeyframes();
-			for (const Data::Keyframe& keyframe : backupPoint->GetKeyframes())
-			{
+			if (keyframe.source == Data::KeyframeSource::Tracked && keyframe.seedFrame == m_params.startFrame)
+				realPoint.RemoveKeyframesInRange(keyframe.frameIndex, keyframe.frameIndex);
+		}
+		for (const Data::Keyframe& keyframe : m_backup)
+		{
+			Data::Keyframe current;
+			if (!realPoint.GetKeyframe(keyframe.frameIndex, current) || current.source != Data::KeyframeSource::Manual)
 				realPoint.AddKeyframe(keyframe);
+		}
+	}
+
+	Tracking::TrackingEngine& RetrackPointCommand::GetEngine()
+	{
+		return m_engine;
+	}
+
+	void RetrackPointCommand::ApplyResults()
+	{
+		const QVector<Tracking::TrackedFrame> results = m_engine.TakeResults();
+		Data::TrackedPoint& trackedPoint = m_document.GetTrackedPoint(m_pointIndex);
+		for (const Tracking::TrackedFrame& frame : results)
+		{
+			if (m_interrupted)
+				return;
+
+			Data::Keyframe keyframe;
+			if (trackedPoint.GetKeyframe(frame.frameIndex, keyframe) && keyframe.source == Data::KeyframeSource::Manual)
+			{
+				m_interrupted = true;
+				m_engine.Cancel();
+				return;
 			}
+			Tracking::AutomaticTrackingManager::CommitFrame(m_document, frame);
 		}
-		m_points.clear();
 	}
-}
\ No newline at end of file
+}
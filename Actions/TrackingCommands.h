@@ -3,24 +3,104 @@
 #include "../common.h"
 #include <QUndoCommand>
 #include "../Data/Document.h"
-#include "../Tracking/TrackingManager.h"
-#include <QTimer>
+#include "../Tracking/TrackingEngine.h"
 
 namespace Actions
 {
+	/**
+	 * \brief Tracks the active points on a range of frames, from its first frame, or, in
+	 * parallel segments mode, between their manual keyframes. The tracking runs in the
+	 * background: the points and the video are updated as the results come in.
+	 */
 	class PerformAutomaticTrackingCommand final : public QUndoCommand
 	{
 	public:
-		explicit PerformAutomaticTrackingCommand(Data::Document& document, const QString& trackerType, int roiSize);
+		/**
+		 * \param startFrame First frame of the range. The points must have a keyframe on it,
+		 * or before it.
+		 * \param endFrame Last frame of the range (inclusive).
+		 * \param downscaleLevels See Tracking::TrackerParams::downscaleLevels.
+		 * \param inferenceThreads See Tracking::TrackerParams::inferenceThreads.
+		 * \param motionModel See Tracking::TrackerParams::motionModel.
+		 * \param cameraMotion See Tracking::TrackerParams::cameraMotion.
+		 */
+		PerformAutomaticTrackingCommand(Data::Document& document, const QString& trackerType, int roiSize, int startFrame, int endFrame, bool parallelSegments = false, int downscaleLevels = 0, int inferenceThreads = 0,
+			Tracking::MotionModelType motionModel = Tracking::MotionModelType::None, bool cameraMotion = false);
 		void redo() override;
 		void undo() override;
 
+		/**
+		 * \brief Engine running the tracking. The same engine is used by every redo, so it
+		 * can be connected to once.
+		 */
+		_NODISCARD Tracking::TrackingEngine& GetEngine();
+
 	private:
+		/**
+		 * \brief Writes the results of the engine to the tracked points, and displays the
+		 * last tracked frame.
+		 */
+		void ApplyResults();
+
+		/**
+		 * \brief Keyframes of an active point on the tracked range, before the tracking.
+		 */
+		struct PointBackup
+		{
+			int pointIndex;
+			QVector<Data::Keyframe> keyframes;
+		};
+
 		Data::Document& m_document;
-		std::vector<std::unique_ptr<Data::TrackedPoint>> m_points;
+		/**
+		 * \brief Only the tracked range is saved: the tracking does not touch the rest of the
+		 * timeline.
+		 */
+		std::vector<PointBackup> m_backups;
 		Tracking::TrackerParams m_params;
-		Tracking::AutomaticTrackingManager m_trackingManager;
-		QTimer m_timer;
+		Tracking::TrackingEngine m_engine;
 	};
 
-}
\ No newline at end of file
+	/**
+	 * \brief Tracks a point again after the user corrected one of its keyframes, over the
+	 * keyframes tracked in the same run after it, and only until the new trajectory joins
+	 * the old one. The tracking runs in the background, without moving the video: the user
+	 * can keep correcting the point in the meantime.
+	 */
+	class RetrackPointCommand final : public QUndoCommand
+	{
+	public:
+		/**
+		 * \param correctedFrame Frame of the corrected keyframe, the tracking starts from it.
+		 */
+		RetrackPointCommand(Data::Document& document, const QString& trackerType, int roiSize, int pointIndex, int correctedFrame, int downscaleLevels = 0, int inferenceThreads = 0,
+			Tracking::MotionModelType motionModel = Tracking::MotionModelType::None, bool cameraMotion = false);
+		void redo() override;
+		void undo() override;
+
+		_NODISCARD Tracking::TrackingEngine& GetEngine();
+
+	private:
+		/**
+		 * \brief Writes the results of the engine to the point, until a manual keyframe is
+		 * met: the user corrected the point there in the meantime, and another command
+		 * re-tracks it from there.
+		 */
+		void ApplyResults();
+
+		Data::Document& m_document;
+		int m_pointIndex;
+		/**
+		 * \brief Keyframes of the point that may be re-tracked, before the tracking.
+		 */
+		QVector<Data::Keyframe> m_backup;
+		int m_backupEnd;
+		/**
+		 * \brief Set when a manual keyframe was met: the results still coming from the
+		 * engine are discarded.
+		 */
+		bool m_interrupted;
+		Tracking::TrackerParams m_params;
+		Tracking::TrackingEngine m_engine;
+	};
+}
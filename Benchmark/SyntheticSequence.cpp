@@ -0,0 +1,156 @@
+#include "SyntheticSequence.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+	constexpr double Pi = 3.14159265358979323846;
+}
+
+namespace Benchmark
+{
+	SyntheticSequence::SyntheticSequence(const SequenceSettings& settings) :
+		Data::FrameSource(),
+		m_settings(settings),
+		m_background(),
+		m_patches(),
+		m_motions()
+	{
+		cv::RNG rng(settings.seed);
+		m_background = std::make_shared<const cv::Mat>(CreateTexture(rng, cv::Size(settings.width, settings.height), 6.0));
+
+		// Spread the rest positions on a grid, far enough from the borders for the points
+		// to stay in the frame.
+		const double margin = settings.motionAmplitude + settings.patchSize;
+		const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(settings.pointCount))));
+		const int rows = (settings.pointCount + columns - 1) / std::max(columns, 1);
+		std::vector<cv::Mat> patches;
+		std::vector<PointMotion> motions;
+		for (int i = 0; i < settings.pointCount; i++)
+		{
+			patches.push_back(CreateTexture(rng, cv::Size(settings.patchSize, settings.patchSize), 1.5));
+			const double x = margin + (settings.width - 2.0 * margin) * (i % columns + 0.5) / columns;
+			const double y = margin + (settings.height - 2.0 * margin) * (i / columns + 0.5) / std::max(rows, 1);
+			motions.push_back({ { x, y }, { rng.uniform(0.5, 1.5), rng.uniform(0.5, 1.5) }, { rng.uniform(0.0, 2.0 * Pi), rng.uniform(0.0, 2.0 * Pi) } });
+		}
+		m_patches = std::make_shared<const std::vector<cv::Mat>>(std::move(patches));
+		m_motions = std::make_shared<const std::vector<PointMotion>>(std::move(motions));
+	}
+
+	SyntheticSequence::SyntheticSequence(const SyntheticSequence& other) :
+		Data::FrameSource(),
+		m_settings(other.m_settings),
+		m_background(other.m_background),
+		m_patches(other.m_patches),
+		m_motions(other.m_motions)
+	{
+	}
+
+	bool SyntheticSequence::Open(const QString&)
+	{
+		return true;
+	}
+
+	std::unique_ptr<Data::FrameSource> SyntheticSequence::Clone() const
+	{
+		std::unique_ptr<SyntheticSequence> clone(new SyntheticSequence(*this));
+		return clone;
+	}
+
+	bool SyntheticSequence::Read(const int frameIndex, cv::Mat& frame)
+	{
+		if (frameIndex < 0 || frameIndex >= m_settings.frameCount)
+			return false;
+
+		// 1. Paste the patches on the background, then hide what is under the occluder.
+		m_background->copyTo(frame);
+		const cv::Rect frameArea(0, 0, m_settings.width, m_settings.height);
+		for (int i = 0; i < m_settings.pointCount; i++)
+		{
+			const cv::Point position = GetPosition(i, frameIndex);
+			const cv::Rect area = cv::Rect(position.x - m_settings.patchSize / 2, position.y - m_settings.patchSize / 2, m_settings.patchSize, m_settings.patchSize) & frameArea;
+			(*m_patches)[i](cv::Rect(area.tl() - (position - cv::Point(m_settings.patchSize / 2, m_settings.patchSize / 2)), area.size())).copyTo(frame(area));
+		}
+		const cv::Range occluder = GetOccluderRange(frameIndex);
+		if (occluder.size() > 0)
+			frame(cv::Rect(occluder.start, 0, occluder.size(), m_settings.height)).setTo(cv::Scalar(96, 96, 96));
+
+		// 2. Degrade the image.
+		if (m_settings.blurSigma > 0.0)
+			cv::GaussianBlur(frame, frame, cv::Size(), m_settings.blurSigma);
+		if (m_settings.noiseSigma > 0.0)
+		{
+			// Seeded by the frame index: reading a frame twice gives the same noise.
+			cv::Mat noise(frame.size(), CV_16SC3);
+			cv::RNG rng(m_settings.seed * 7919u + static_cast<unsigned int>(frameIndex));
+			rng.fill(noise, cv::RNG::NORMAL, 0.0, m_settings.noiseSigma);
+			cv::Mat noisy;
+			frame.convertTo(noisy, CV_16SC3);
+			noisy += noise;
+			noisy.convertTo(frame, CV_8UC3);
+		}
+		return true;
+	}
+
+	int SyntheticSequence::GetFrameCount() const
+	{
+		return m_settings.frameCount;
+	}
+
+	int SyntheticSequence::GetFrameRate() const
+	{
+		return 25;
+	}
+
+	int SyntheticSequence::GetWidth() const
+	{
+		return m_settings.width;
+	}
+
+	int SyntheticSequence::GetHeight() const
+	{
+		return m_settings.height;
+	}
+
+	cv::Point SyntheticSequence::GetPosition(const int pointIndex, const int frameIndex) const
+	{
+		const PointMotion& motion = (*m_motions)[pointIndex];
+		const double t = 2.0 * Pi * m_settings.motionCycles * frameIndex / std::max(m_settings.frameCount, 1);
+		return { cvRound(motion.rest.x + m_settings.motionAmplitude * std::sin(motion.frequencies.x * t + motion.phases.x)),
+			cvRound(motion.rest.y + m_settings.motionAmplitude * std::sin(motion.frequencies.y * t + motion.phases.y)) };
+	}
+
+	bool SyntheticSequence::IsOccluded(const int pointIndex, const int frameIndex) const
+	{
+		const cv::Range occluder = GetOccluderRange(frameIndex);
+		const int x = GetPosition(pointIndex, frameIndex).x;
+		return x + m_settings.patchSize / 2 > occluder.start && x - m_settings.patchSize / 2 < occluder.end;
+	}
+
+	const SequenceSettings& SyntheticSequence::GetSettings() const
+	{
+		return m_settings;
+	}
+
+	cv::Mat SyntheticSequence::CreateTexture(cv::RNG& rng, const cv::Size size, const double smoothing)
+	{
+		cv::Mat texture(size, CV_8UC3);
+		rng.fill(texture, cv::RNG::UNIFORM, 0, 256);
+		cv::GaussianBlur(texture, texture, cv::Size(), smoothing);
+		// Blurring flattens the contrast: stretch it back.
+		cv::normalize(texture, texture, 0, 255, cv::NORM_MINMAX);
+		return texture;
+	}
+
+	cv::Range SyntheticSequence::GetOccluderRange(const int frameIndex) const
+	{
+		const int width = static_cast<int>(m_settings.occluderWidth * m_settings.width);
+		if (width <= 0)
+			return cv::Range(0, 0);
+
+		// The occluder crosses the frame once over the sequence, from left to right.
+		const int start = -width + (m_settings.width + width) * frameIndex / std::max(m_settings.frameCount - 1, 1);
+		return cv::Range(std::clamp(start, 0, m_settings.width), std::clamp(start + width, 0, m_settings.width));
+	}
+}
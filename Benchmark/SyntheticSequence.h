@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../common.h"
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <QString>
+#include "../Data/FrameSource.h"
+
+namespace Benchmark
+{
+	struct SequenceSettings
+	{
+		int width{ 1920 };
+		int height{ 1080 };
+		int frameCount{ 300 };
+		int pointCount{ 16 };
+		/**
+		 * \brief Size of the textured patch of each point, in pixels.
+		 */
+		int patchSize{ 32 };
+		/**
+		 * \brief Largest displacement of a point from its rest position, in pixels. Each
+		 * point moves on its own Lissajous curve.
+		 */
+		double motionAmplitude{ 120.0 };
+		/**
+		 * \brief Number of oscillations of the points over the sequence.
+		 */
+		double motionCycles{ 2.0 };
+		/**
+		 * \brief Standard deviation of the Gaussian blur of the frames, in pixels. 0 means
+		 * no blur.
+		 */
+		double blurSigma{ 0.0 };
+		/**
+		 * \brief Standard deviation of the noise added to the frames, in grey levels.
+		 */
+		double noiseSigma{ 0.0 };
+		/**
+		 * \brief Width of the bar sweeping over the frames and hiding the points under it,
+		 * as a fraction of the frame width. 0 means no occlusion.
+		 */
+		double occluderWidth{ 0.0 };
+		unsigned int seed{ 1 };
+	};
+
+	/**
+	 * \brief Generated video of textured patches moving over a textured background, with
+	 * known trajectories. Frames are generated on the fly: any frame can be read in any
+	 * order, and the same settings always give the same frames.
+	 */
+	class SyntheticSequence final : public Data::FrameSource
+	{
+	public:
+		explicit SyntheticSequence(const SequenceSettings& settings);
+
+		/**
+		 * \brief The sequence is ready once constructed: the path is ignored.
+		 */
+		bool Open(const QString& path) override;
+		_NODISCARD std::unique_ptr<Data::FrameSource> Clone() const override;
+		bool Read(int frameIndex, cv::Mat& frame) override;
+
+		_NODISCARD int GetFrameCount() const override;
+		_NODISCARD int GetFrameRate() const override;
+		_NODISCARD int GetWidth() const override;
+		_NODISCARD int GetHeight() const override;
+
+		/**
+		 * \brief Position of the centre of a point on a frame: the ground truth.
+		 */
+		_NODISCARD cv::Point GetPosition(int pointIndex, int frameIndex) const;
+		/**
+		 * \brief Whether the point is hidden by the occluder on the given frame.
+		 */
+		_NODISCARD bool IsOccluded(int pointIndex, int frameIndex) const;
+		_NODISCARD const SequenceSettings& GetSettings() const;
+
+	private:
+		/**
+		 * \brief Used by Clone: shares the generated data.
+		 */
+		SyntheticSequence(const SyntheticSequence& other);
+
+		/**
+		 * \brief Motion of a point: its rest position and the phases of its curve.
+		 */
+		struct PointMotion
+		{
+			cv::Point2d rest;
+			cv::Point2d frequencies;
+			cv::Point2d phases;
+		};
+
+		/**
+		 * \brief Random texture, smoothed so that it has structure at several scales.
+		 */
+		_NODISCARD static cv::Mat CreateTexture(cv::RNG& rng, cv::Size size, double smoothing);
+		/**
+		 * \brief Horizontal range covered by the occluder on the given frame.
+		 */
+		_NODISCARD cv::Range GetOccluderRange(int frameIndex) const;
+
+		SequenceSettings m_settings;
+		/**
+		 * \brief Shared by the clones: they never change once generated.
+		 */
+		std::shared_ptr<const cv::Mat> m_background;
+		std::shared_ptr<const std::vector<cv::Mat>> m_patches;
+		std::shared_ptr<const std::vector<PointMotion>> m_motions;
+	};
+}
@@ -0,0 +1,203 @@
+#include "TrackerBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <QFile>
+#include "../Data/Document.h"
+#include "../Tracking/TrackingManager.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace Benchmark
+{
+	double BenchmarkResult::GetFramesPerSecond() const
+	{
+		return trackingSeconds > 0.0 ? trackedFrames / trackingSeconds : 0.0;
+	}
+
+	double BenchmarkResult::GetPointFramesPerSecond() const
+	{
+		return GetFramesPerSecond() * settings.pointCount;
+	}
+
+	QJsonObject BenchmarkResult::ToJson() const
+	{
+		return {
+			{ "tracker", trackerType },
+			{ "width", settings.width },
+			{ "height", settings.height },
+			{ "frames", settings.frameCount },
+			{ "points", settings.pointCount },
+			{ "blurSigma", settings.blurSigma },
+			{ "noiseSigma", settings.noiseSigma },
+			{ "occluderWidth", settings.occluderWidth },
+			{ "motionAmplitude", settings.motionAmplitude },
+			{ "downscaleLevels", downscaleLevels },
+			{ "motionModel", Tracking::GetMotionModelNames()[static_cast<int>(motionModel)] },
+			{ "cameraMotion", cameraMotion },
+			{ "trackedFrames", trackedFrames },
+			{ "lostFrame", lostFrame },
+			{ "error", error },
+			{ "trackingSeconds", trackingSeconds },
+			{ "wallSeconds", wallSeconds },
+			{ "framesPerSecond", GetFramesPerSecond() },
+			{ "pointFramesPerSecond", GetPointFramesPerSecond() },
+			{ "processPeakMemoryBytes", static_cast<double>(processPeakMemoryBytes) },
+			{ "baselineMemoryBytes", static_cast<double>(baselineMemoryBytes) },
+			{ "meanPixelError", meanError },
+			{ "maxPixelError", maxError },
+			{ "meanOccludedPixelError", meanOccludedError }
+		};
+	}
+
+	TrackerBenchmark::TrackerBenchmark(const SequenceSettings& settings, const int roiSize, const int downscaleLevels, const Tracking::MotionModelType motionModel, const bool cameraMotion) :
+		m_sequence(settings),
+		m_roiSize(roiSize),
+		m_downscaleLevels(downscaleLevels),
+		m_motionModel(motionModel),
+		m_cameraMotion(cameraMotion)
+	{
+	}
+
+	BenchmarkResult TrackerBenchmark::Run(const QString& trackerType) const
+	{
+		using Clock = std::chrono::steady_clock;
+		const SequenceSettings& settings = m_sequence.GetSettings();
+		BenchmarkResult result;
+		result.trackerType = trackerType;
+		result.settings = settings;
+		// The batched trackers ignore these options: do not label their results with them.
+		const bool batched = Tracking::IsBatchedTrackerType(trackerType);
+		result.downscaleLevels = batched ? 0 : m_downscaleLevels;
+		result.motionModel = batched ? Tracking::MotionModelType::None : m_motionModel;
+		result.cameraMotion = !batched && m_cameraMotion;
+
+		// 1. Create a document on the sequence, with a point on each patch.
+		Data::Document document;
+		document.GetVideo().SetFrameCacheBudget(0);
+		document.GetVideo().LoadFromSource(m_sequence.Clone(), "synthetic");
+		QVector<QPoint> startPositions;
+		for (int i = 0; i < settings.pointCount; i++)
+		{
+			Data::TrackedPoint& trackedPoint = document.CreateTrackedPoint();
+			const cv::Point position = m_sequence.GetPosition(i, 0);
+			trackedPoint.AddKeyframe(Data::Keyframe{ QPoint(position.x, position.y), 0, Data::KeyframeSource::Manual, 1.0f, -1 });
+			document.SetActive(trackedPoint);
+			startPositions.push_back(QPoint(position.x, position.y));
+		}
+		result.baselineMemoryBytes = GetResidentMemory();
+
+		// 2. Track, the way the TrackingEngine runs a job.
+		const Tracking::TrackerParams params{ m_roiSize, 0, settings.frameCount - 1, trackerType, document, false, -1, result.downscaleLevels, 0, result.motionModel, result.cameraMotion };
+		const Clock::time_point startTime = Clock::now();
+		double visibleErrorSum = 0.0;
+		int visibleSamples = 0;
+		double occludedErrorSum = 0.0;
+		int occludedSamples = 0;
+		try
+		{
+			Tracking::AutomaticTrackingManager trackingManager(params);
+			std::unique_ptr<Data::FrameSource> source = m_sequence.Clone();
+			cv::Mat startImage;
+			source->Read(0, startImage);
+			trackingManager.InitializeTrackers(startImage, startPositions);
+			Tracking::TrackingPipeline pipeline(std::move(source), trackingManager.GetPreprocessing());
+			pipeline.Start(1, trackingManager.GetEndFrame());
+
+			Tracking::FrameBundle bundle;
+			while (pipeline.Pop(bundle))
+			{
+				const Clock::time_point tickTime = Clock::now();
+				Tracking::TrackedFrame trackedFrame;
+				try
+				{
+					trackedFrame = trackingManager.TickTrackers(bundle);
+				}
+				catch (const Tracking::TrackingException& ex)
+				{
+					result.lostFrame = bundle.frameIndex;
+					result.error = ex.what();
+					break;
+				}
+				result.trackingSeconds += std::chrono::duration<double>(Clock::now() - tickTime).count();
+				result.trackedFrames++;
+
+				// 3. Compare with the ground truth.
+				for (int i = 0; i < trackedFrame.pointIndices.size(); i++)
+				{
+					const int pointIndex = trackedFrame.pointIndices[i];
+					const cv::Point truth = m_sequence.GetPosition(pointIndex, trackedFrame.frameIndex);
+					const double error = std::hypot(trackedFrame.positions[i].x() - truth.x, trackedFrame.positions[i].y() - truth.y);
+					if (m_sequence.IsOccluded(pointIndex, trackedFrame.frameIndex))
+					{
+						occludedErrorSum += error;
+						occludedSamples++;
+					}
+					else
+					{
+						visibleErrorSum += error;
+						visibleSamples++;
+						result.maxError = std::max(result.maxError, error);
+					}
+				}
+			}
+			pipeline.Stop();
+		}
+		catch (const std::exception& ex)
+		{
+			result.error = ex.what();
+		}
+		result.wallSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		result.processPeakMemoryBytes = GetPeakResidentMemory();
+		result.meanError = visibleSamples > 0 ? visibleErrorSum / visibleSamples : 0.0;
+		result.meanOccludedError = occludedSamples > 0 ? occludedErrorSum / occludedSamples : 0.0;
+		return result;
+	}
+
+	size_t TrackerBenchmark::GetResidentMemory()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.WorkingSetSize;
+		return 0;
+#elif defined(__linux__)
+		// Second field of statm: resident pages.
+		QFile statm("/proc/self/statm");
+		if (!statm.open(QIODevice::ReadOnly))
+			return 0;
+		const QList<QByteArray> fields = statm.readAll().split(' ');
+		return fields.size() > 1 ? static_cast<size_t>(fields[1].toULongLong()) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+		return 0;
+#endif
+	}
+
+	size_t TrackerBenchmark::GetPeakResidentMemory()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+#elif defined(__linux__)
+		// The VmHWM line of status, in kB.
+		QFile status("/proc/self/status");
+		if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+			return 0;
+		for (const QByteArray& line : status.readAll().split('\n'))
+		{
+			if (line.startsWith("VmHWM:"))
+				return static_cast<size_t>(line.mid(6).trimmed().split(' ').first().toULongLong()) * 1024;
+		}
+		return 0;
+#else
+		return 0;
+#endif
+	}
+}
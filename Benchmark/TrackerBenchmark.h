@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../common.h"
+#include <QJsonObject>
+#include <QString>
+#include "../Tracking/MotionModel.h"
+#include "SyntheticSequence.h"
+
+namespace Benchmark
+{
+	/**
+	 * \brief Measures of one tracker type on one synthetic sequence.
+	 */
+	struct BenchmarkResult
+	{
+		QString trackerType;
+		SequenceSettings settings;
+		int downscaleLevels{ 0 };
+		Tracking::MotionModelType motionModel{ Tracking::MotionModelType::None };
+		bool cameraMotion{ false };
+		/**
+		 * \brief Number of frames tracked after the first one.
+		 */
+		int trackedFrames{ 0 };
+		/**
+		 * \brief Frame on which a point was lost, which stops the run, or -1.
+		 */
+		int lostFrame{ -1 };
+		QString error;
+		/**
+		 * \brief Time spent in the trackers only, without the decoding of the frames.
+		 */
+		double trackingSeconds{ 0.0 };
+		/**
+		 * \brief Time of the whole run, from the initialization of the trackers to the end
+		 * of the pipeline.
+		 */
+		double wallSeconds{ 0.0 };
+		/**
+		 * \brief High-water mark of the resident memory of the process at the end of the
+		 * run. The mark never goes down: it covers the runs done before this one in the
+		 * same process too. Run a single tracker type per process to measure it alone.
+		 */
+		size_t processPeakMemoryBytes{ 0 };
+		/**
+		 * \brief Resident memory of the process before the run.
+		 */
+		size_t baselineMemoryBytes{ 0 };
+		/**
+		 * \brief Distance between the tracked and the true positions, in pixels, over the
+		 * frames where the point is visible.
+		 */
+		double meanError{ 0.0 };
+		double maxError{ 0.0 };
+		/**
+		 * \brief Same as meanError, over the frames where the point is hidden.
+		 */
+		double meanOccludedError{ 0.0 };
+
+		_NODISCARD double GetFramesPerSecond() const;
+		_NODISCARD double GetPointFramesPerSecond() const;
+		_NODISCARD QJsonObject ToJson() const;
+	};
+
+	/**
+	 * \brief Runs a tracker type through the AutomaticTrackingManager on a synthetic
+	 * sequence, the way the TrackingEngine does, and compares the result with the ground
+	 * truth of the sequence.
+	 */
+	class TrackerBenchmark
+	{
+	public:
+		TrackerBenchmark(const SequenceSettings& settings, int roiSize, int downscaleLevels = 0, Tracking::MotionModelType motionModel = Tracking::MotionModelType::None, bool cameraMotion = false);
+
+		/**
+		 * \brief Tracks all the points of the sequence, from its first frame to its last
+		 * frame or until a point is lost.
+		 */
+		_NODISCARD BenchmarkResult Run(const QString& trackerType) const;
+
+		/**
+		 * \brief Resident memory of the process, in bytes. 0 if unknown on this platform.
+		 */
+		_NODISCARD static size_t GetResidentMemory();
+		/**
+		 * \brief Largest resident memory of the process since it started, in bytes, as
+		 * measured by the system: allocations freed between two samples are counted. 0 if
+		 * unknown on this platform.
+		 */
+		_NODISCARD static size_t GetPeakResidentMemory();
+
+	private:
+		/**
+		 * \brief Generated once, and cloned by the runs.
+		 */
+		SyntheticSequence m_sequence;
+		int m_roiSize;
+		int m_downscaleLevels;
+		Tracking::MotionModelType m_motionModel;
+		bool m_cameraMotion;
+	};
+}
@@ -0,0 +1,133 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QTextStream>
+
+#include "../Logging/Log.h"
+#include "../Tracking/TrackingManager.h"
+#include "TrackerBenchmark.h"
+
+
+/**
+ * \brief Entry point of the tracker benchmark: runs tracker types on synthetic videos
+ * whose trajectories are known, and writes their speed and accuracy to a JSON file.
+ * \param argc Number of arguments.
+ * \param argv Value of the arguments.
+ * \return Exit code: 0 if the results were written, 1 if not, 2 if the arguments are
+ * wrong.
+ */
+int main(int argc, char** argv)
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("ReferenceTracker-benchmark");
+
+    // 1. Parse the arguments.
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the speed and the accuracy of the trackers on synthetic videos.");
+    parser.addHelpOption();
+    const QCommandLineOption outputOption({ "o", "output" }, "JSON file the results are written to.", "file", "benchmark.json");
+    const QCommandLineOption trackersOption({ "t", "trackers" }, "Comma-separated tracker types. Defaults to all of them: " + Tracking::GetTrackerTypes().toList().join(", ") + ". The peak memory is the one of the whole process: give a single type to measure it alone.", "types");
+    const QCommandLineOption resolutionsOption("resolutions", "Comma-separated resolutions among 720p, 1080p and 4K.", "list", "720p,1080p,4K");
+    const QCommandLineOption framesOption({ "f", "frames" }, "Number of frames of each video.", "count", "200");
+    const QCommandLineOption pointsOption({ "p", "points" }, "Number of tracked points.", "count", "16");
+    const QCommandLineOption roiOption({ "r", "roi" }, "Size of the region of interest around each point, in pixels.", "pixels", "40");
+    const QCommandLineOption downscaleOption({ "d", "downscale" }, "Run the trackers on the frames halved this many times, then refine at full resolution.", "levels", "0");
+    const QCommandLineOption motionModelOption({ "m", "motion-model" }, "Motion model centring the search of the trackers: none, velocity or kalman.", "model", "none");
+    const QCommandLineOption cameraMotionOption("camera-motion", "Add the estimated motion of the camera to the predictions of the motion model.");
+    const QCommandLineOption motionOption("motion", "Largest displacement of the points from their rest position, in pixels.", "pixels", "120");
+    const QCommandLineOption blurOption("blur", "Standard deviation of the blur of the frames, in pixels.", "sigma", "0");
+    const QCommandLineOption noiseOption("noise", "Standard deviation of the noise of the frames, in grey levels.", "sigma", "0");
+    const QCommandLineOption occlusionOption("occlusion", "Width of the bar sweeping over the points, as a fraction of the frame width.", "fraction", "0");
+    const QCommandLineOption seedOption("seed", "Seed of the generated videos.", "seed", "1");
+    parser.addOptions({ outputOption, trackersOption, resolutionsOption, framesOption, pointsOption, roiOption, downscaleOption, motionModelOption, cameraMotionOption, motionOption, blurOption, noiseOption, occlusionOption, seedOption });
+    parser.process(application);
+
+    const QStringList trackerTypes = parser.isSet(trackersOption) ? parser.value(trackersOption).split(',', Qt::SkipEmptyParts) : Tracking::GetTrackerTypes().toList();
+    QVector<QSize> resolutions;
+    for (const QString& resolution : parser.value(resolutionsOption).split(',', Qt::SkipEmptyParts))
+    {
+        if (resolution == "720p")
+            resolutions.push_back({ 1280, 720 });
+        else if (resolution == "1080p")
+            resolutions.push_back({ 1920, 1080 });
+        else if (resolution.compare("4K", Qt::CaseInsensitive) == 0)
+            resolutions.push_back({ 3840, 2160 });
+        else
+        {
+            qCritical() << "Unknown resolution:" << resolution;
+            return 2;
+        }
+    }
+
+    Benchmark::SequenceSettings settings;
+    settings.frameCount = parser.value(framesOption).toInt();
+    settings.pointCount = parser.value(pointsOption).toInt();
+    settings.motionAmplitude = parser.value(motionOption).toDouble();
+    settings.blurSigma = parser.value(blurOption).toDouble();
+    settings.noiseSigma = parser.value(noiseOption).toDouble();
+    settings.occluderWidth = parser.value(occlusionOption).toDouble();
+    settings.seed = parser.value(seedOption).toUInt();
+    const int roiSize = parser.value(roiOption).toInt();
+    const int downscaleLevels = parser.value(downscaleOption).toInt();
+    const bool cameraMotion = parser.isSet(cameraMotionOption);
+    const QString motionModelName = parser.value(motionModelOption).toLower();
+    Tracking::MotionModelType motionModel = Tracking::MotionModelType::None;
+    if (motionModelName == "velocity")
+        motionModel = Tracking::MotionModelType::ConstantVelocity;
+    else if (motionModelName == "kalman")
+        motionModel = Tracking::MotionModelType::Kalman;
+    else if (motionModelName != "none")
+    {
+        qCritical() << "Unknown motion model:" << motionModelName;
+        return 2;
+    }
+    if (settings.frameCount < 2 || settings.pointCount < 1 || roiSize <= 0 || downscaleLevels < 0)
+    {
+        qCritical() << "There must be at least 2 frames, 1 point, and a region of interest of at least one pixel.";
+        return 2;
+    }
+
+    // The tracking logs every tracked position: far too much for a benchmark.
+    QLoggingCategory::setFilterRules("*.debug=false");
+    const Logging::AsyncLogSink logSink;
+
+    // 2. Run every tracker type on every resolution.
+    QTextStream out(stdout);
+    QJsonArray results;
+    for (const QSize& resolution : resolutions)
+    {
+        settings.width = resolution.width();
+        settings.height = resolution.height();
+        const Benchmark::TrackerBenchmark benchmark(settings, roiSize, downscaleLevels, motionModel, cameraMotion);
+        for (const QString& trackerType : trackerTypes)
+        {
+            const Benchmark::BenchmarkResult result = benchmark.Run(trackerType);
+            out << QString("%1x%2 %3: %4 fps, %5 points*frames/s, error %6 px (max %7 px), process peak memory %8 MB%9")
+                .arg(settings.width)
+                .arg(settings.height)
+                .arg(trackerType)
+                .arg(result.GetFramesPerSecond(), 0, 'f', 1)
+                .arg(result.GetPointFramesPerSecond(), 0, 'f', 1)
+                .arg(result.meanError, 0, 'f', 2)
+                .arg(result.maxError, 0, 'f', 2)
+                .arg(result.processPeakMemoryBytes / (1024.0 * 1024.0), 0, 'f', 0)
+                .arg(result.error.isEmpty() ? QString() : "\n    " + result.error) << '\n';
+            out.flush();
+            results.push_back(result.ToJson());
+        }
+    }
+
+    // 3. Write the results.
+    QFile file(parser.value(outputOption));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qCritical() << "Could not write" << file.fileName();
+        return 1;
+    }
+    file.write(QJsonDocument(QJsonObject{ { "results", results } }).toJson());
+    return 0;
+}
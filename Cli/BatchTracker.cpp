@@ -0,0 +1,200 @@
+#include "BatchTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include "../Data/Document.h"
+#include "../Tracking/TrackingEngine.h"
+
+namespace Cli
+{
+	BatchTracker::BatchTracker(BatchOptions options) :
+		m_options(std::move(options)),
+		m_threadBudget(0),
+		m_outputMutex(),
+		m_output(stdout)
+	{
+	}
+
+	int BatchTracker::Run(const QStringList& projectPaths)
+	{
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point startTime = Clock::now();
+
+		// 1. Spread the projects over the threads.
+		std::vector<ProjectResult> results(projectPaths.size());
+		std::atomic_int nextProject(0);
+		const auto trackProjects = [this, &projectPaths, &results, &nextProject]
+		{
+			for (int i = nextProject++; i < projectPaths.size(); i = nextProject++)
+			{
+				const ProjectResult& result = results[i] = TrackProject(projectPaths[i]);
+				const double framesPerSecond = result.seconds > 0.0 ? result.trackedFrames / result.seconds : 0.0;
+				Print(QString("%1: %2, %3 frames in %4 s (%5 fps)%6")
+					.arg(result.path, result.succeeded ? "done" : "FAILED")
+					.arg(result.trackedFrames)
+					.arg(result.seconds, 0, 'f', 1)
+					.arg(framesPerSecond, 0, 'f', 1)
+					.arg(result.message.isEmpty() ? QString() : "\n    " + QString(result.message).replace('\n', "\n    ")));
+			}
+		};
+		const int threadCount = std::clamp(m_options.jobCount, 1, std::max(static_cast<int>(projectPaths.size()), 1));
+		// The projects tracked at the same time share the cores.
+		m_threadBudget = std::max(QThread::idealThreadCount() / threadCount, 1);
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(trackProjects);
+		}
+		trackProjects();
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		// 2. Sum up.
+		const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		int trackedFrames = 0;
+		int failedProjects = 0;
+		Tracking::PipelineStatistics statistics;
+		for (const ProjectResult& result : results)
+		{
+			trackedFrames += result.trackedFrames;
+			failedProjects += result.succeeded ? 0 : 1;
+			statistics.Add(result.statistics);
+		}
+		Print(QString("Tracked %1 frames of %2 projects in %3 s (%4 fps), %5 failed.")
+			.arg(trackedFrames)
+			.arg(projectPaths.size())
+			.arg(seconds, 0, 'f', 1)
+			.arg(seconds > 0.0 ? trackedFrames / seconds : 0.0, 0, 'f', 1)
+			.arg(failedProjects));
+		statistics.Log();
+		return failedProjects;
+	}
+
+	ProjectResult BatchTracker::TrackProject(const QString& projectPath) const
+	{
+		using Clock = std::chrono::steady_clock;
+		ProjectResult result;
+		result.path = projectPath;
+
+		// 1. Load the project. The document lives on this thread for its whole life.
+		Data::Document document;
+		document.GetVideo().SetFrameCacheBudget(0);
+		try
+		{
+			document.LoadFromFile(projectPath);
+		}
+		catch (const std::exception& ex)
+		{
+			result.message = ex.what();
+			return result;
+		}
+		if (!document.GetFilePath().has_value())
+		{
+			result.message = "Could not open the project.";
+			return result;
+		}
+		if (!document.GetVideo().IsLoaded())
+		{
+			result.message = "Could not open the video of the project.";
+			return result;
+		}
+
+		// 2. Track. There is no event loop on this thread: the results are committed once
+		// the engine is done, and the error is received through a direct connection.
+		const int endFrame = m_options.endFrame >= 0 ? m_options.endFrame : document.GetVideo().GetFrameCount() - 1;
+		const Tracking::TrackerParams params{ m_options.roiSize, m_options.startFrame, endFrame, m_options.trackerType, document, m_options.parallelSegments, -1, m_options.downscaleLevels, m_options.inferenceThreads, m_options.motionModel, m_options.cameraMotion, m_threadBudget };
+		const Clock::time_point startTime = Clock::now();
+		QVector<Tracking::TrackedFrame> trackedFrames;
+		{
+			Tracking::TrackingEngine engine(params);
+			QObject::connect(&engine, &Tracking::TrackingEngine::TrackingFailed, &engine, [&result](const QString& message)
+				{
+					result.message = message;
+				}, Qt::DirectConnection);
+			try
+			{
+				if (!engine.Start())
+					return result;
+			}
+			catch (const std::exception& ex)
+			{
+				// An exception escaping this thread would end the whole batch.
+				result.message = ex.what();
+				return result;
+			}
+			engine.Wait();
+			trackedFrames = engine.TakeResults();
+			engine.CommitResults(trackedFrames);
+			result.statistics = engine.GetPipelineStatistics();
+		}
+		result.seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		result.trackedFrames = trackedFrames.size();
+		result.succeeded = result.message.isEmpty();
+
+		// 3. Save what was tracked, even if some points were lost on the way.
+		if (!trackedFrames.isEmpty())
+		{
+			const QString fileName = QFileInfo(projectPath).fileName();
+			try
+			{
+				if (m_options.outputDirectory.isEmpty())
+					document.Save([] { return std::optional<QString>(); });
+				else if (QDir().mkpath(m_options.outputDirectory))
+					document.Save([this, &fileName] { return std::optional<QString>(QDir(m_options.outputDirectory).filePath(fileName)); }, true);
+				else
+					throw std::runtime_error(QString("Could not create %1.").arg(m_options.outputDirectory).toStdString());
+			}
+			catch (const std::exception& ex)
+			{
+				result.succeeded = false;
+				result.message += (result.message.isEmpty() ? "" : "\n") + QString(ex.what());
+			}
+		}
+		if (!m_options.csvDirectory.isEmpty())
+		{
+			const QString csvPath = QDir(m_options.csvDirectory).filePath(QFileInfo(projectPath).completeBaseName() + ".csv");
+			if (!QDir().mkpath(m_options.csvDirectory) || !ExportCsv(document, csvPath))
+			{
+				result.succeeded = false;
+				result.message += (result.message.isEmpty() ? "" : "\n") + QString("Could not write ") + csvPath + ".";
+			}
+		}
+		return result;
+	}
+
+	bool BatchTracker::ExportCsv(Data::Document& document, const QString& csvPath)
+	{
+		QFile file(csvPath);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+			return false;
+
+		QTextStream out(&file);
+		out << "point,frame,x,y,source,confidence\n";
+		for (const std::unique_ptr<Data::TrackedPoint>& trackedPoint : document.GetTrackedPoints())
+		{
+			for (const auto& [position, frameIndex, source, confidence, seedFrame] : trackedPoint->GetKeyframes())
+			{
+				out << '"' << QString(trackedPoint->GetName()).replace('"', "\"\"") << "\","
+					<< frameIndex << ',' << position.x() << ',' << position.y() << ','
+					<< (source == Data::KeyframeSource::Manual ? "manual" : "tracked") << ',' << confidence << '\n';
+			}
+		}
+		return out.status() == QTextStream::Ok;
+	}
+
+	void BatchTracker::Print(const QString& line)
+	{
+		std::lock_guard lock(m_outputMutex);
+		m_output << line << '\n';
+		m_output.flush();
+	}
+}
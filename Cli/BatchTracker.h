@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../common.h"
+#include <mutex>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include "../Tracking/MotionModel.h"
+#include "../Tracking/TrackingPipeline.h"
+
+namespace Data
+{
+	class Document;
+}
+
+namespace Cli
+{
+	struct BatchOptions
+	{
+		QString trackerType{ "CSRT" };
+		int roiSize{ 40 };
+		int startFrame{ 0 };
+		/**
+		 * \brief Last frame to track (inclusive). -1 tracks until the end of each video.
+		 */
+		int endFrame{ -1 };
+		bool parallelSegments{ false };
+		/**
+		 * \brief See Tracking::TrackerParams::downscaleLevels.
+		 */
+		int downscaleLevels{ 0 };
+		/**
+		 * \brief See Tracking::TrackerParams::inferenceThreads.
+		 */
+		int inferenceThreads{ 0 };
+		/**
+		 * \brief See Tracking::TrackerParams::motionModel.
+		 */
+		Tracking::MotionModelType motionModel{ Tracking::MotionModelType::None };
+		/**
+		 * \brief See Tracking::TrackerParams::cameraMotion.
+		 */
+		bool cameraMotion{ false };
+		/**
+		 * \brief Number of projects tracked at the same time.
+		 */
+		int jobCount{ 1 };
+		/**
+		 * \brief Where to write the tracked projects. Empty to overwrite them.
+		 */
+		QString outputDirectory;
+		/**
+		 * \brief Where to write a CSV file of the keyframes of each project. Empty to not
+		 * export them.
+		 */
+		QString csvDirectory;
+	};
+
+	/**
+	 * \brief Outcome of the tracking of one project.
+	 */
+	struct ProjectResult
+	{
+		QString path;
+		bool succeeded{ false };
+		QString message;
+		int trackedFrames{ 0 };
+		double seconds{ 0.0 };
+		Tracking::PipelineStatistics statistics;
+	};
+
+	/**
+	 * \brief Tracks a list of projects without any user interface, and saves them.
+	 * Each project is loaded in a document of its own and tracked by a TrackingEngine, so
+	 * the projects run in parallel on BatchOptions::jobCount threads, each of them using
+	 * the worker threads of its engine.
+	 */
+	class BatchTracker
+	{
+	public:
+		explicit BatchTracker(BatchOptions options);
+
+		/**
+		 * \brief Tracks all the projects, and prints a line per project and the overall
+		 * throughput.
+		 * \return Number of projects that could not be fully tracked.
+		 */
+		int Run(const QStringList& projectPaths);
+
+	private:
+		_NODISCARD ProjectResult TrackProject(const QString& projectPath) const;
+		/**
+		 * \brief Writes the keyframes of all the points of the document, one per line.
+		 */
+		static bool ExportCsv(Data::Document& document, const QString& csvPath);
+		void Print(const QString& line);
+
+		BatchOptions m_options;
+		/**
+		 * \brief Threads each project may keep busy: see Tracking::TrackerParams::threadBudget.
+		 */
+		int m_threadBudget;
+		/**
+		 * \brief Serializes the output of the threads.
+		 */
+		std::mutex m_outputMutex;
+		QTextStream m_output;
+	};
+}
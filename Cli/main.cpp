@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QLoggingCategory>
+#include <QThread>
+
+#include "../Logging/Log.h"
+#include "../Tracking/TrackingManager.h"
+#include "BatchTracker.h"
+
+
+/**
+ * \brief Entry point of the command-line tracker: tracks a list of projects without any
+ * display, for instance on a render farm.
+ * \param argc Number of arguments.
+ * \param argv Value of the arguments.
+ * \return Exit code: 0 if all the projects were tracked, 1 if some failed, 2 if the
+ * arguments are wrong.
+ */
+int main(int argc, char** argv)
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("ReferenceTracker-cli");
+
+    // 1. Parse the arguments.
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Tracks the active points of Tracking Project Files (*.tpj) and saves them.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("projects", "Projects to track.", "<project.tpj>...");
+    const QCommandLineOption trackerOption({ "t", "tracker" }, "Tracker type: " + Tracking::GetTrackerTypes().toList().join(", ") + ".", "type", "CSRT");
+    const QCommandLineOption roiOption({ "r", "roi" }, "Size of the region of interest around each point, in pixels.", "pixels", "40");
+    const QCommandLineOption startOption({ "s", "start" }, "First frame: the points start from their position on this frame.", "frame", "0");
+    const QCommandLineOption endOption({ "e", "end" }, "Last frame to track (inclusive). Defaults to the end of each video.", "frame", "-1");
+    const QCommandLineOption downscaleOption({ "d", "downscale" }, "Run the trackers on the frames halved this many times, then refine at full resolution.", "levels", "0");
+    const QCommandLineOption inferenceThreadsOption("inference-threads", "Number of threads of the neural network trackers (GOTURN). 0 keeps the default.", "count", "0");
+    const QCommandLineOption motionOption({ "m", "motion-model" }, "Motion model centring the search of the trackers: none, velocity or kalman.", "model", "none");
+    const QCommandLineOption cameraMotionOption("camera-motion", "Add the estimated motion of the camera to the predictions of the motion model.");
+    const QCommandLineOption segmentsOption("segments", "Track each segment between two manual keyframes independently, in parallel.");
+    const QCommandLineOption jobsOption({ "j", "jobs" }, "Number of projects tracked at the same time.", "count", QString::number(std::max(QThread::idealThreadCount() / 2, 1)));
+    const QCommandLineOption outputOption({ "o", "output" }, "Directory where the tracked projects are written, instead of overwriting them.", "directory");
+    const QCommandLineOption csvOption("csv", "Directory where a CSV file of the keyframes of each project is written.", "directory");
+    const QCommandLineOption verboseOption({ "v", "verbose" }, "Print the debug messages of the tracking (debug builds only).");
+    parser.addOptions({ trackerOption, roiOption, startOption, endOption, downscaleOption, inferenceThreadsOption, motionOption, cameraMotionOption, segmentsOption, jobsOption, outputOption, csvOption, verboseOption });
+    parser.process(application);
+
+    const QStringList projects = parser.positionalArguments();
+    if (projects.isEmpty())
+    {
+        qCritical() << "No project to track.";
+        parser.showHelp(2);
+    }
+
+    Cli::BatchOptions options;
+    options.trackerType = parser.value(trackerOption);
+    options.roiSize = parser.value(roiOption).toInt();
+    options.startFrame = parser.value(startOption).toInt();
+    options.endFrame = parser.value(endOption).toInt();
+    options.parallelSegments = parser.isSet(segmentsOption);
+    options.downscaleLevels = parser.value(downscaleOption).toInt();
+    options.inferenceThreads = parser.value(inferenceThreadsOption).toInt();
+    options.cameraMotion = parser.isSet(cameraMotionOption);
+    options.jobCount = parser.value(jobsOption).toInt();
+    options.outputDirectory = parser.value(outputOption);
+    options.csvDirectory = parser.value(csvOption);
+    if (!Tracking::IsValidTrackerType(options.trackerType))
+    {
+        qCritical() << "Unknown tracker type:" << options.trackerType;
+        return 2;
+    }
+    const QString motionModel = parser.value(motionOption).toLower();
+    if (motionModel == "velocity")
+        options.motionModel = Tracking::MotionModelType::ConstantVelocity;
+    else if (motionModel == "kalman")
+        options.motionModel = Tracking::MotionModelType::Kalman;
+    else if (motionModel != "none")
+    {
+        qCritical() << "Unknown motion model:" << motionModel;
+        return 2;
+    }
+    if (options.roiSize <= 0)
+    {
+        qCritical() << "The region of interest must be at least one pixel wide.";
+        return 2;
+    }
+    if (options.downscaleLevels < 0)
+    {
+        qCritical() << "The number of downscale levels cannot be negative.";
+        return 2;
+    }
+    if (Tracking::IsBatchedTrackerType(options.trackerType)
+        && (options.downscaleLevels != 0 || options.motionModel != Tracking::MotionModelType::None || options.cameraMotion))
+    {
+        qCritical() << "The" << options.trackerType << "tracker tracks all the points together: it supports neither --downscale, --motion-model nor --camera-motion.";
+        return 2;
+    }
+
+    // The tracking logs every keyframe it adds: far too much for a batch.
+    if (!parser.isSet(verboseOption))
+        QLoggingCategory::setFilterRules("*.debug=false");
+
+    // 2. Track. The messages of the tracking threads are written in the background from
+    // here: showHelp exits without running the destructors, so not earlier.
+    const Logging::AsyncLogSink logSink;
+    Cli::BatchTracker batchTracker(options);
+    return batchTracker.Run(projects) == 0 ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+#include "DiskFrameCache.h"
+#include <algorithm>
+#include <cstring>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include "../Logging/Log.h"
+
+namespace
+{
+	constexpr int32_t CacheMagicNumber = 0x7a3e91d2;
+	constexpr int32_t CacheVersion = 101; // 1.0.1
+	constexpr qint64 BytesPerGigabyte = 1024LL * 1024LL * 1024LL;
+	/**
+	 * \brief Alignment of the slot table and of the frame slots in a segment file.
+	 */
+	constexpr size_t SlotAlignment = 4096;
+
+	/**
+	 * \brief Header at the very beginning of a segment file.
+	 */
+	struct SegmentHeader
+	{
+		int32_t magicNumber;
+		int32_t version;
+		int32_t frameCount;
+		int32_t width;
+		int32_t height;
+		int32_t type;
+		int32_t slotCount;
+	};
+
+	size_t AlignUp(const size_t size)
+	{
+		return (size + SlotAlignment - 1) / SlotAlignment * SlotAlignment;
+	}
+}
+
+namespace Data
+{
+	DiskFrameCache::DiskFrameCache() :
+		m_key(),
+		m_segments(),
+		m_locations(),
+		m_slotCount(0),
+		m_slotSize(0),
+		m_slotsOffset(0),
+		m_nextSegmentNumber(0),
+		m_full(false),
+		m_isOpen(false),
+		m_frameCount(0),
+		m_width(0),
+		m_height(0),
+		m_type(0),
+		m_maxSize(DefaultMaxSizeGigabytes * BytesPerGigabyte)
+	{
+	}
+
+	DiskFrameCache::~DiskFrameCache()
+	{
+		Close();
+	}
+
+	bool DiskFrameCache::Open(const QString& videoPath, const int frameCount, const int width, const int height, const int type)
+	{
+		Close();
+		if (frameCount <= 0 || width <= 0 || height <= 0)
+			return false;
+
+		// 1. Compute the layout of the segments, and make sure one fits in the allowed size.
+		const size_t frameSize = static_cast<size_t>(width) * static_cast<size_t>(height) * CV_ELEM_SIZE(type);
+		m_slotSize = AlignUp(frameSize);
+		m_slotCount = static_cast<int>(std::max<qint64>(SegmentSize / static_cast<qint64>(m_slotSize), 1));
+		m_slotsOffset = AlignUp(sizeof(SegmentHeader) + sizeof(int32_t) * static_cast<size_t>(m_slotCount));
+		m_frameCount = frameCount;
+		m_width = width;
+		m_height = height;
+		m_type = type;
+		if (GetSegmentFileSize() > m_maxSize)
+		{
+			qCWarning(LogVideo) << "Disk frame cache disabled for" << videoPath << ": a segment would need" << GetSegmentFileSize() / (1024 * 1024) << "MB.";
+			return false;
+		}
+		if (!QDir().mkpath(GetCacheDirectory()))
+		{
+			qCWarning(LogVideo) << "Could not create the disk frame cache directory" << GetCacheDirectory();
+			return false;
+		}
+
+		// 2. Map the segments cached by the previous sessions. Those that do not match the
+		// video (an older version of the cache for instance) are deleted.
+		m_key = GetCacheKey(videoPath);
+		m_locations.assign(static_cast<size_t>(frameCount), -1);
+		m_isOpen = true;
+		const QDir directory(GetCacheDirectory());
+		for (const QString& fileName : directory.entryList({ m_key + "-*.rtfc" }, QDir::Files, QDir::Name))
+		{
+			const QString path = directory.filePath(fileName);
+			const int number = QFileInfo(fileName).completeBaseName().mid(m_key.size() + 1).toInt();
+			m_nextSegmentNumber = std::max(m_nextSegmentNumber, number + 1);
+			if (!LoadSegment(path))
+				QFile::remove(path);
+		}
+
+		// 3. The maximum size may have been lowered since the last session.
+		MakeRoom(0);
+		return true;
+	}
+
+	void DiskFrameCache::Close()
+	{
+		m_segments.clear(); // Closing the files also unmaps them.
+		m_locations.clear();
+		m_key.clear();
+		m_nextSegmentNumber = 0;
+		m_full = false;
+		m_isOpen = false;
+		m_frameCount = 0;
+	}
+
+	bool DiskFrameCache::IsOpen() const
+	{
+		return m_isOpen;
+	}
+
+	bool DiskFrameCache::Get(const int frameIndex, cv::Mat& frame) const
+	{
+		if (!IsOpen() || frameIndex < 0 || frameIndex >= m_frameCount || m_locations[frameIndex] < 0)
+			return false;
+
+		const int location = m_locations[frameIndex];
+		const Segment& segment = m_segments[location / m_slotCount];
+		frame = cv::Mat(m_height, m_width, m_type, segment.slots + static_cast<size_t>(location % m_slotCount) * m_slotSize);
+		return true;
+	}
+
+	void DiskFrameCache::Insert(const int frameIndex, const cv::Mat& frame)
+	{
+		if (!IsOpen() || m_full || frameIndex < 0 || frameIndex >= m_frameCount || m_locations[frameIndex] >= 0)
+			return;
+		if (frame.cols != m_width || frame.rows != m_height || frame.type() != m_type)
+			return;
+
+		// 1. Append to a segment that has a free slot: only the last segment of each session
+		// can be partially filled. Create a new one when they are all full.
+		auto segmentIt = std::find_if(m_segments.begin(), m_segments.end(), [this](const Segment& segment)
+			{
+				return segment.usedSlots < m_slotCount;
+			});
+		if (segmentIt == m_segments.end())
+		{
+			if (!CreateSegment())
+			{
+				m_full = true;
+				return;
+			}
+			segmentIt = std::prev(m_segments.end());
+		}
+		Segment& segment = *segmentIt;
+		const int slot = segment.usedSlots;
+
+		// 2. The frame goes to a continuous slot: copy it row by row if it has a padding.
+		cv::Mat slotMat(m_height, m_width, m_type, segment.slots + static_cast<size_t>(slot) * m_slotSize);
+		frame.copyTo(slotMat);
+
+		// Only flag the slot once it is completely written.
+		segment.slotFrames[slot] = frameIndex + 1;
+		segment.usedSlots++;
+		m_locations[frameIndex] = static_cast<int>(segmentIt - m_segments.begin()) * m_slotCount + slot;
+	}
+
+	void DiskFrameCache::SetMaxSize(const int gigabytes)
+	{
+		m_maxSize = static_cast<qint64>(gigabytes) * BytesPerGigabyte;
+	}
+
+	bool DiskFrameCache::LoadSegment(const QString& path)
+	{
+		auto file = std::make_unique<QFile>(path);
+		if (!file->open(QIODevice::ReadWrite) || file->size() != GetSegmentFileSize())
+			return false;
+
+		const SegmentHeader expectedHeader{ CacheMagicNumber, CacheVersion, m_frameCount, m_width, m_height, m_type, m_slotCount };
+		SegmentHeader header{};
+		if (file->read(reinterpret_cast<char*>(&header), sizeof(SegmentHeader)) != sizeof(SegmentHeader)
+			|| std::memcmp(&header, &expectedHeader, sizeof(SegmentHeader)) != 0)
+			return false;
+
+		uchar* mapping = file->map(0, file->size());
+		if (mapping == nullptr)
+			return false;
+
+		// The segment is used by this session: it is the most recently used one.
+		file->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+		Segment segment{ std::move(file), reinterpret_cast<int32_t*>(mapping + sizeof(SegmentHeader)), mapping + m_slotsOffset, 0 };
+		const int segmentIndex = static_cast<int>(m_segments.size());
+		while (segment.usedSlots < m_slotCount && segment.slotFrames[segment.usedSlots] != 0)
+		{
+			const int frameIndex = segment.slotFrames[segment.usedSlots] - 1;
+			if (frameIndex >= 0 && frameIndex < m_frameCount)
+				m_locations[frameIndex] = segmentIndex * m_slotCount + segment.usedSlots;
+			segment.usedSlots++;
+		}
+
+		m_segments.push_back(std::move(segment));
+		return true;
+	}
+
+	bool DiskFrameCache::CreateSegment()
+	{
+		const qint64 fileSize = GetSegmentFileSize();
+		if (!MakeRoom(fileSize))
+		{
+			qCDebug(LogVideo) << "The disk frame cache is full: no more frames are stored for this video.";
+			return false;
+		}
+
+		const QString path = QDir(GetCacheDirectory()).filePath(m_key + "-" + QString::number(m_nextSegmentNumber++) + ".rtfc");
+		auto file = std::make_unique<QFile>(path);
+		if (!file->open(QIODevice::ReadWrite | QIODevice::Truncate) || !file->resize(fileSize))
+		{
+			qCWarning(LogVideo) << "Could not create the disk frame cache segment" << path;
+			file->remove();
+			return false;
+		}
+
+		// The slot table is all zeros after the resize: all the slots are free.
+		const SegmentHeader header{ CacheMagicNumber, CacheVersion, m_frameCount, m_width, m_height, m_type, m_slotCount };
+		file->write(reinterpret_cast<const char*>(&header), sizeof(SegmentHeader));
+		file->flush();
+
+		uchar* mapping = file->map(0, fileSize);
+		if (mapping == nullptr)
+		{
+			qCWarning(LogVideo) << "Could not map the disk frame cache segment" << path << "in memory.";
+			file->remove();
+			return false;
+		}
+		m_segments.push_back({ std::move(file), reinterpret_cast<int32_t*>(mapping + sizeof(SegmentHeader)), mapping + m_slotsOffset, 0 });
+		return true;
+	}
+
+	bool DiskFrameCache::MakeRoom(const qint64 size) const
+	{
+		// Oldest first.
+		const QFileInfoList files = QDir(GetCacheDirectory()).entryInfoList({ "*.rtfc" }, QDir::Files, QDir::Time | QDir::Reversed);
+		qint64 totalSize = size;
+		for (const QFileInfo& file : files)
+		{
+			totalSize += file.size();
+		}
+
+		// The frames of the open video may be displayed: its own segments are never evicted.
+		for (const QFileInfo& file : files)
+		{
+			if (totalSize <= m_maxSize)
+				break;
+			if (IsOwnSegment(file.absoluteFilePath()))
+				continue;
+			// Fails for the files mapped by another instance on some systems: skip them.
+			if (QFile::remove(file.absoluteFilePath()))
+			{
+				qCDebug(LogVideo) << "Evicted the disk frame cache segment" << file.fileName();
+				totalSize -= file.size();
+			}
+		}
+		return totalSize <= m_maxSize;
+	}
+
+	bool DiskFrameCache::IsOwnSegment(const QString& path) const
+	{
+		return std::any_of(m_segments.cbegin(), m_segments.cend(), [&path](const Segment& segment)
+			{
+				return QFileInfo(segment.file->fileName()).absoluteFilePath() == path;
+			});
+	}
+
+	qint64 DiskFrameCache::GetSegmentFileSize() const
+	{
+		return static_cast<qint64>(m_slotsOffset + m_slotSize * static_cast<size_t>(m_slotCount));
+	}
+
+	QString DiskFrameCache::GetCacheDirectory()
+	{
+		return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/frames";
+	}
+
+	QString DiskFrameCache::GetCacheKey(const QString& videoPath)
+	{
+		// The key changes as soon as the video is moved or modified, so an outdated cache
+		// is never used.
+		const QFileInfo videoInfo(videoPath);
+		const QString key = videoInfo.absoluteFilePath()
+			+ "|" + QString::number(videoInfo.size())
+			+ "|" + QString::number(videoInfo.lastModified().toMSecsSinceEpoch());
+		return QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+	}
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "../common.h"
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <QFile>
+
+namespace Data
+{
+	/**
+	 * \brief Persistent cache of decoded video frames, stored in memory-mapped files.
+	 * The frames of a video are identified by the path, size and modification time of the
+	 * video, so that the frames decoded in a session are still available after restarting
+	 * the application.
+	 *
+	 * The frames are appended to segment files as they are decoded, in the order they come:
+	 * a segment has a fixed number of slots, preceded by a table telling which frame each
+	 * filled slot holds. Segments are only created when the previous one is full, so the
+	 * disk space used follows the frames actually cached, whatever the length of the video
+	 * and whether or not the file system supports sparse files.
+	 * All the segment files of all the videos share a single size budget: when a new
+	 * segment does not fit, the least recently used segments of the other videos are
+	 * deleted first.
+	 */
+	class DiskFrameCache
+	{
+	public:
+		static constexpr int DefaultMaxSizeGigabytes = 64;
+		/**
+		 * \brief Approximate size of a segment file, in bytes. A segment holds at least one
+		 * frame.
+		 */
+		static constexpr qint64 SegmentSize = 256LL * 1024LL * 1024LL;
+
+		DiskFrameCache();
+		~DiskFrameCache();
+		Q_DISABLE_COPY(DiskFrameCache);
+
+		/**
+		 * \brief Opens the cached frames of the given video, if any.
+		 * \param videoPath Path to the video file on the disk.
+		 * \param frameCount Number of frames of the video.
+		 * \param width Width of a video frame.
+		 * \param height Height of a video frame.
+		 * \param type OpenCV type of the decoded frames (CV_8UC3 for instance).
+		 * \return Whether the cache can be used. It cannot when a single frame does not fit
+		 * in the maximum size, or when the cache directory cannot be written.
+		 */
+		bool Open(const QString& videoPath, int frameCount, int width, int height, int type);
+		void Close();
+		_NODISCARD bool IsOpen() const;
+
+		/**
+		 * \brief Tries getting a frame from the cache. The returned matrix points directly
+		 * into a mapped file: nothing is decoded or copied. It remains valid until the
+		 * cache is closed, and must not be written into.
+		 * \return Whether the frame was in the cache.
+		 */
+		_NODISCARD bool Get(int frameIndex, cv::Mat& frame) const;
+		/**
+		 * \brief Copies a frame into the next free slot of the cache. Frames that do not
+		 * have the size and type given to Open are ignored, and so are all the frames once
+		 * the size budget is used up by this video.
+		 */
+		void Insert(int frameIndex, const cv::Mat& frame);
+
+		/**
+		 * \brief Sets the maximum size of all the cache files together, for all the
+		 * videos. Takes effect on the next segment created, or on the next call to Open.
+		 */
+		void SetMaxSize(int gigabytes);
+
+	private:
+		/**
+		 * \brief A mapped segment file.
+		 */
+		struct Segment
+		{
+			std::unique_ptr<QFile> file;
+			/**
+			 * \brief One entry per slot: the index of the frame it holds plus one, or 0 when
+			 * the slot is free. The slots are filled in order.
+			 */
+			int32_t* slotFrames;
+			/**
+			 * \brief Start of the first slot.
+			 */
+			uchar* slots;
+			int usedSlots;
+		};
+
+		/**
+		 * \brief Maps the given segment file, and indexes its frames.
+		 * \return Whether the file is a valid segment of the open video.
+		 */
+		bool LoadSegment(const QString& path);
+		/**
+		 * \brief Creates and maps a new empty segment, after making room for it.
+		 * \return Whether the segment could be created.
+		 */
+		bool CreateSegment();
+		/**
+		 * \brief Deletes the least recently used segment files of the other videos until
+		 * the given number of bytes fits in the maximum size.
+		 * \return Whether the bytes fit.
+		 */
+		bool MakeRoom(qint64 size) const;
+		_NODISCARD bool IsOwnSegment(const QString& path) const;
+		_NODISCARD qint64 GetSegmentFileSize() const;
+		_NODISCARD static QString GetCacheDirectory();
+		/**
+		 * \brief Key of the video, shared by the names of its segment files.
+		 */
+		_NODISCARD static QString GetCacheKey(const QString& videoPath);
+
+		QString m_key;
+		std::vector<Segment> m_segments;
+		/**
+		 * \brief Location of each frame of the video: segment index times m_slotCount plus
+		 * slot index, or -1 when the frame is not cached.
+		 */
+		std::vector<int> m_locations;
+		/**
+		 * \brief Number of slots of each segment.
+		 */
+		int m_slotCount;
+		/**
+		 * \brief Distance in bytes between two frame slots. Larger than the size of a
+		 * frame, so that each frame starts on an aligned address.
+		 */
+		size_t m_slotSize;
+		/**
+		 * \brief Offset of the first slot in a segment file.
+		 */
+		size_t m_slotsOffset;
+		/**
+		 * \brief Number used to name the next segment of the video.
+		 */
+		int m_nextSegmentNumber;
+		/**
+		 * \brief Set when no segment can be created anymore: the frames are not inserted
+		 * until the next call to Open.
+		 */
+		bool m_full;
+		bool m_isOpen;
+		int m_frameCount;
+		int m_width;
+		int m_height;
+		int m_type;
+		qint64 m_maxSize;
+	};
+}
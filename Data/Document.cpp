@@ -1,12 +1,13 @@
 #include "Document.h"
 
 #include <QFile>
-#include <QDebug>
 #include <QDataStream>
+#include "../Profiling/Profiler.h"
+#include "../Logging/Log.h"
 
 namespace
 {
-	constexpr int32_t DataVersion = 100; // 1.0.0
+	constexpr int32_t DataVersion = 103; // 1.0.3
 	constexpr int32_t MagicNumber = 0x12ab8fa1; // 1.0.0
 }
 
@@ -66,10 +67,12 @@ namespace Data
 
 	void Document::LoadFromFile(const QString& filePath)
 	{
+		const Profiling::ScopedTimer timer("Document load");
+
 		// 1. Before changing anything, ensure the file at the specified path exists.
 		if (!QFile::exists(filePath))
 		{
-			qWarning() << "Document at" << filePath << "does not exist.";
+			qCWarning(LogData) << "Document at" << filePath << "does not exist.";
 			return;
 		}
 
@@ -94,24 +97,19 @@ namespace Data
 			m_trackedPoints[i]->SetPointIndex(static_cast<int>(i));
 		}
 		MarkDirty();
-		for (const auto& pt : m_trackedPoints)
-			qDebug() << pt->GetName() << ":" << pt->GetPointIndex();
-		qDebug() << "- - - - - -";
+		qCDebug(LogData) << "Created point" << m_trackedPoints[index]->GetName() << "at index" << index << "of" << m_trackedPoints.size() << ".";
 		emit TrackedPointAdded(*m_trackedPoints[index]);
 		return *m_trackedPoints[index];
 	}
 
 	void Document::RemoveTrackedPoint(const int index)
 	{
-		qDebug() << "Was asked to remove point with index " << index;
 		m_trackedPoints.erase(m_trackedPoints.begin() + index);
 		for (size_t i = index; i < m_trackedPoints.size(); i++)
 		{
 			m_trackedPoints[i]->SetPointIndex(m_trackedPoints[i]->GetPointIndex() - 1);
 		}
-		for (const auto& pt : m_trackedPoints)
-			qDebug() << pt->GetName() << ":" << pt->GetPointIndex();
-		qDebug() << "- - - - - -";
+		qCDebug(LogData) << "Removed the point at index" << index << "," << m_trackedPoints.size() << "left.";
 		MarkDirty();
 		emit TrackedPointRemoved(index);
 	}
@@ -126,10 +124,7 @@ namespace Data
 		{
 			m_trackedPoints[i]->SetPointIndex(static_cast<int>(i));
 		}
-
-		for (const auto& pt : m_trackedPoints)
-			qDebug() << pt->GetName() << ":" << pt->GetPointIndex();
-		qDebug() << "- - - - - -";
+		qCDebug(LogData) << "Inserted point" << m_trackedPoints[index]->GetName() << "at index" << index << "of" << m_trackedPoints.size() << ".";
 
 		emit TrackedPointAdded(*m_trackedPoints[index]);
 		return *m_trackedPoints[index];	
@@ -193,6 +188,8 @@ namespace Data
 
 	void Document::SaveImpl() const
 	{
+		const Profiling::ScopedTimer timer("Document save");
+
 		if (!m_filePath.has_value())
 			throw std::runtime_error("Document::SaveImpl called but m_filePath has no value.");
 
@@ -209,7 +206,8 @@ namespace Data
 		 */
 
 		QFile file(m_filePath.value());
-		file.open(QIODevice::WriteOnly);
+		if (!file.open(QIODevice::WriteOnly))
+			throw std::runtime_error(QString("Could not write %1: %2").arg(file.fileName(), file.errorString()).toStdString());
 		QDataStream out(&file);
 
 		constexpr int testInteger = 31;
@@ -247,6 +245,9 @@ namespace Data
 
 		// Save again the test integer.
 		out << static_cast<int32_t>(testInteger);
+
+		if (out.status() != QDataStream::Ok || !file.flush())
+			throw std::runtime_error(QString("Could not write %1: %2").arg(file.fileName(), file.errorString()).toStdString());
 	}
 
 	void Document::LoadImpl(const QString& path)
@@ -261,8 +262,8 @@ namespace Data
 		// Load the header.
 		int32_t dataVersion;
 		in >> dataVersion;
-		if (dataVersion != DataVersion)
-			qWarning() << "The file was saved with a different version of the software.";
+		if (dataVersion > DataVersion)
+			qCWarning(LogData) << "The file was saved with a newer version of the software.";
 
 		int32_t magicNumber;
 		in >> magicNumber;
@@ -286,7 +287,7 @@ namespace Data
 			int32_t tpIndex;
 			in >> tpIndex;
 			TrackedPoint& trackedPoint = CreateTrackedPoint(tpName, tpIndex);
-			trackedPoint.Load(in);
+			trackedPoint.Load(in, dataVersion);
 		}
 
 		// Load the active indices.
@@ -60,6 +60,9 @@ namespace Data
 		 *
 		 * \param saveAs Force the document to ask for a new path using the saveAsCallback,
 		 * even if a path is currently saved in the document.
+		 *
+		 * \throw std::runtime_error If the file cannot be written. The document then stays
+		 * dirty.
 		 */
 		void Save(const SaveAsCallback& saveAsCallback, bool saveAs = false);
 		void LoadFromFile(const QString& filePath);
@@ -95,7 +98,7 @@ namespace Data
 		/**
 		 * \brief When this function is called, it is expected that
 		 * m_filePath has a value. Otherwise a runtime error is
-		 * thrown.
+		 * thrown, as well as when the file cannot be written.
 		 */
 		void SaveImpl() const;
 		/**
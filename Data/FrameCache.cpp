@@ -0,0 +1,93 @@
+#include "FrameCache.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr size_t BytesPerMegabyte = 1024 * 1024;
+}
+
+namespace Data
+{
+	FrameCache::FrameCache(const int budgetMegabytes) :
+		m_entries(),
+		m_lookup(),
+		m_budgetBytes(static_cast<size_t>(std::max(budgetMegabytes, 0)) * BytesPerMegabyte),
+		m_usedBytes(0)
+	{
+	}
+
+	bool FrameCache::Get(const int frameIndex, cv::Mat& frame)
+	{
+		const auto it = m_lookup.find(frameIndex);
+		if (it == m_lookup.end())
+			return false;
+
+		// Move the entry to the front of the list: it is now the most recently used one.
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		frame = it->second->second;
+		return true;
+	}
+
+	void FrameCache::Insert(const int frameIndex, const cv::Mat& frame)
+	{
+		const size_t frameSize = GetFrameSize(frame);
+		if (frame.empty() || frameSize > m_budgetBytes)
+			return;
+
+		// 1. If the frame is already cached, replace it.
+		const auto it = m_lookup.find(frameIndex);
+		if (it != m_lookup.end())
+		{
+			m_usedBytes -= GetFrameSize(it->second->second);
+			m_entries.erase(it->second);
+			m_lookup.erase(it);
+		}
+
+		// 2. Make some room for the new frame.
+		EvictToBudget(m_budgetBytes - frameSize);
+
+		// 3. Insert it as the most recently used frame.
+		m_entries.emplace_front(frameIndex, frame);
+		m_lookup[frameIndex] = m_entries.begin();
+		m_usedBytes += frameSize;
+	}
+
+	void FrameCache::Clear()
+	{
+		m_entries.clear();
+		m_lookup.clear();
+		m_usedBytes = 0;
+	}
+
+	void FrameCache::SetBudget(const int megabytes)
+	{
+		m_budgetBytes = static_cast<size_t>(std::max(megabytes, 0)) * BytesPerMegabyte;
+		EvictToBudget(m_budgetBytes);
+	}
+
+	int FrameCache::GetBudget() const
+	{
+		return static_cast<int>(m_budgetBytes / BytesPerMegabyte);
+	}
+
+	size_t FrameCache::GetMemoryUsage() const
+	{
+		return m_usedBytes;
+	}
+
+	void FrameCache::EvictToBudget(const size_t budgetBytes)
+	{
+		while (m_usedBytes > budgetBytes && !m_entries.empty())
+		{
+			const Entry& leastRecentlyUsed = m_entries.back();
+			m_usedBytes -= GetFrameSize(leastRecentlyUsed.second);
+			m_lookup.erase(leastRecentlyUsed.first);
+			m_entries.pop_back();
+		}
+	}
+
+	size_t FrameCache::GetFrameSize(const cv::Mat& frame)
+	{
+		return frame.total() * frame.elemSize();
+	}
+}
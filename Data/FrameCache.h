@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../common.h"
+#include <list>
+#include <unordered_map>
+#include <opencv2/core.hpp>
+
+namespace Data
+{
+	/**
+	 * \brief Memory-budgeted cache of decoded video frames, indexed by frame number.
+	 * When the budget is exceeded, the least recently used frames are evicted first.
+	 * The frames are stored as cv::Mat, which are reference-counted: getting a frame
+	 * out of the cache does not copy its pixels.
+	 */
+	class FrameCache
+	{
+	public:
+		static constexpr int DefaultBudgetMegabytes = 1024;
+
+		explicit FrameCache(int budgetMegabytes = DefaultBudgetMegabytes);
+
+		/**
+		 * \brief Tries getting a frame from the cache. On success, the frame becomes the
+		 * most recently used one.
+		 * \param frameIndex Index of the frame in the video.
+		 * \param frame Return param for the frame. Shares its data with the cached frame.
+		 * \return Whether the frame was in the cache.
+		 */
+		_NODISCARD bool Get(int frameIndex, cv::Mat& frame);
+		/**
+		 * \brief Adds a frame to the cache, evicting the least recently used frames if
+		 * needed to stay below the memory budget. Frames bigger than the whole budget are
+		 * not cached.
+		 * The cache keeps a reference to the data of the frame: the caller must not write
+		 * into it afterwards.
+		 */
+		void Insert(int frameIndex, const cv::Mat& frame);
+		void Clear();
+
+		/**
+		 * \brief Sets the maximum amount of memory used by the cached frames. A budget
+		 * of 0 disables the cache.
+		 */
+		void SetBudget(int megabytes);
+		_NODISCARD int GetBudget() const;
+		_NODISCARD size_t GetMemoryUsage() const;
+
+	private:
+		using Entry = std::pair<int, cv::Mat>;
+
+		void EvictToBudget(size_t budgetBytes);
+		_NODISCARD static size_t GetFrameSize(const cv::Mat& frame);
+
+		/**
+		 * \brief Cached frames, sorted from the most recently used to the least recently
+		 * used one.
+		 */
+		std::list<Entry> m_entries;
+		/**
+		 * \brief Position of each cached frame in m_entries. Key: frame index.
+		 */
+		std::unordered_map<int, std::list<Entry>::iterator> m_lookup;
+		/**
+		 * \brief Maximum number of bytes the cached frames can use.
+		 */
+		size_t m_budgetBytes;
+		/**
+		 * \brief Number of bytes used by the cached frames.
+		 */
+		size_t m_usedBytes;
+	};
+}
@@ -0,0 +1,110 @@
+#include "FramePool.h"
+
+namespace Data
+{
+	FramePool& FramePool::GetInstance()
+	{
+		// Intentionally never destroyed: frames allocated from the pool may still be
+		// released during the destruction of other static objects.
+		static FramePool* instance = new FramePool();
+		return *instance;
+	}
+
+	FramePool::FramePool() :
+		m_mutex(),
+		m_freeBuffers(),
+		m_pooledBytes(0)
+	{
+	}
+
+	cv::Mat FramePool::Allocate(const int rows, const int cols, const int type)
+	{
+		cv::Mat frame;
+		frame.allocator = this;
+		frame.create(rows, cols, type);
+		return frame;
+	}
+
+	cv::UMatData* FramePool::allocate(const int dims, const int* sizes, const int type, void* data, size_t* step, cv::AccessFlag, cv::UMatUsageFlags) const
+	{
+		// 1. Compute the steps and the total size, the same way as the default OpenCV
+		// allocator does.
+		size_t total = CV_ELEM_SIZE(type);
+		for (int i = dims - 1; i >= 0; i--)
+		{
+			if (step)
+			{
+				if (data && step[i] != CV_AUTOSTEP)
+				{
+					CV_Assert(total <= step[i]);
+					total = step[i];
+				}
+				else
+				{
+					step[i] = total;
+				}
+			}
+			total *= sizes[i];
+		}
+
+		cv::UMatData* u = new cv::UMatData(this);
+		u->size = total;
+
+		// 2. Memory provided by the caller: nothing to allocate.
+		if (data)
+		{
+			u->data = u->origdata = static_cast<uchar*>(data);
+			u->flags |= cv::UMatData::USER_ALLOCATED;
+			return u;
+		}
+
+		// 3. Reuse a buffer of the same size if there is one.
+		uchar* buffer = nullptr;
+		{
+			std::lock_guard lock(m_mutex);
+			const auto it = m_freeBuffers.find(total);
+			if (it != m_freeBuffers.end() && !it->second.empty())
+			{
+				buffer = it->second.back();
+				it->second.pop_back();
+				m_pooledBytes -= total;
+			}
+		}
+		if (buffer == nullptr)
+			buffer = static_cast<uchar*>(cv::fastMalloc(total));
+
+		u->data = u->origdata = buffer;
+		return u;
+	}
+
+	bool FramePool::allocate(cv::UMatData* data, cv::AccessFlag, cv::UMatUsageFlags) const
+	{
+		return data != nullptr;
+	}
+
+	void FramePool::deallocate(cv::UMatData* data) const
+	{
+		if (!data)
+			return;
+
+		CV_Assert(data->urefcount == 0);
+		CV_Assert(data->refcount == 0);
+		if (!(data->flags & cv::UMatData::USER_ALLOCATED))
+		{
+			bool pooled = false;
+			{
+				std::lock_guard lock(m_mutex);
+				if (m_pooledBytes + data->size <= MaxPooledBytes)
+				{
+					m_freeBuffers[data->size].push_back(data->origdata);
+					m_pooledBytes += data->size;
+					pooled = true;
+				}
+			}
+			if (!pooled)
+				cv::fastFree(data->origdata);
+			data->origdata = nullptr;
+		}
+		delete data;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../common.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <QtGlobal>
+
+namespace Data
+{
+	/**
+	 * \brief OpenCV allocator recycling the pixel buffers of the decoded frames.
+	 * Decoded frames all have the same size, so once a few frames were decoded, each new
+	 * decode reuses the buffer of a frame nobody references anymore instead of asking the
+	 * system for megabytes of fresh memory.
+	 *
+	 * The frames stay regular reference-counted cv::Mat: when the last reference to a frame
+	 * goes away (in the player, the caches, a tracker...), its buffer returns to the pool.
+	 * The pool is process-wide, so that it outlives every frame allocated from it.
+	 */
+	class FramePool final : public cv::MatAllocator
+	{
+	public:
+		/**
+		 * \brief Above this amount of unused memory, the released buffers are freed
+		 * instead of being kept for later.
+		 */
+		static constexpr size_t MaxPooledBytes = 512 * 1024 * 1024;
+
+		_NODISCARD static FramePool& GetInstance();
+
+		/**
+		 * \brief Returns a frame whose buffer comes from the pool. Decoding into it (with
+		 * cv::VideoCapture::read for instance) writes directly into the recycled buffer.
+		 */
+		_NODISCARD cv::Mat Allocate(int rows, int cols, int type);
+
+		cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+		bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+		void deallocate(cv::UMatData* data) const override;
+
+	private:
+		FramePool();
+		~FramePool() override = default;
+		Q_DISABLE_COPY(FramePool);
+
+		/**
+		 * \brief Protects the members below. The frames are allocated and released by the
+		 * decoding threads as well as by the GUI thread.
+		 */
+		mutable std::mutex m_mutex;
+		/**
+		 * \brief Unused buffers. Key: size of the buffers in bytes.
+		 */
+		mutable std::unordered_map<size_t, std::vector<uchar*>> m_freeBuffers;
+		/**
+		 * \brief Total size of the unused buffers.
+		 */
+		mutable size_t m_pooledBytes;
+	};
+}
@@ -0,0 +1,136 @@
+#include "FramePrefetcher.h"
+#include <algorithm>
+#include "../Logging/Log.h"
+
+namespace Data
+{
+	FramePrefetcher::FramePrefetcher(const int capacity) :
+		m_capacity(std::max(capacity, 1)),
+		m_source(),
+		m_frameCount(0),
+		m_thread(),
+		m_mutex(),
+		m_condition(),
+		m_buffer(),
+		m_nextIndex(0),
+		m_stopRequested(false)
+	{
+	}
+
+	FramePrefetcher::~FramePrefetcher()
+	{
+		Stop();
+	}
+
+	bool FramePrefetcher::Start(std::unique_ptr<FrameSource> source, const int firstFrameIndex)
+	{
+		Stop();
+
+		if (!source)
+		{
+			qCWarning(LogVideo) << "Read-ahead disabled: could not open the video a second time.";
+			return false;
+		}
+		m_source = std::move(source);
+		m_frameCount = m_source->GetFrameCount();
+
+		// No lock needed: the thread is not running yet.
+		m_buffer.clear();
+		m_nextIndex = firstFrameIndex;
+		m_stopRequested = false;
+		m_thread = std::thread(&FramePrefetcher::Run, this);
+		return true;
+	}
+
+	void FramePrefetcher::Stop()
+	{
+		if (!m_thread.joinable())
+			return;
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_stopRequested = true;
+		}
+		m_condition.notify_all();
+		m_thread.join();
+
+		m_buffer.clear();
+		m_source.reset();
+	}
+
+	bool FramePrefetcher::Pop(const int frameIndex, cv::Mat& frame)
+	{
+		bool hit = false;
+		{
+			std::lock_guard lock(m_mutex);
+
+			// 1. Drop the frames the playhead already went past.
+			while (!m_buffer.empty() && m_buffer.front().first < frameIndex)
+				m_buffer.pop_front();
+
+			// 2. Hit: take the frame out of the buffer, which frees a slot for the decoder.
+			if (!m_buffer.empty() && m_buffer.front().first == frameIndex)
+			{
+				frame = std::move(m_buffer.front().second);
+				m_buffer.pop_front();
+				hit = true;
+			}
+			// 3. Miss: the frame is decoded by the caller. Restart from the frame after it,
+			// unless the decoder is already about to reach it.
+			else if (m_buffer.empty() && m_nextIndex == frameIndex)
+			{
+				m_nextIndex = frameIndex + 1;
+			}
+			else if (m_buffer.empty() || m_buffer.front().first != frameIndex + 1)
+			{
+				m_buffer.clear();
+				m_nextIndex = frameIndex + 1;
+			}
+		}
+		m_condition.notify_all();
+		return hit;
+	}
+
+	int FramePrefetcher::GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+	void FramePrefetcher::Run()
+	{
+		std::unique_lock lock(m_mutex);
+		while (true)
+		{
+			// 1. Wait until there is room in the buffer and something left to decode.
+			m_condition.wait(lock, [this]
+				{
+					return m_stopRequested || (static_cast<int>(m_buffer.size()) < m_capacity && m_nextIndex < m_frameCount);
+				});
+			if (m_stopRequested)
+				return;
+
+			// 2. Decode without holding the lock, so that Pop never waits for a decode.
+			const int index = m_nextIndex;
+			lock.unlock();
+
+			cv::Mat frame;
+			const bool success = m_source->Read(index, frame);
+
+			lock.lock();
+
+			// 3. The playhead may have jumped somewhere else during the decode, in which
+			// case the frame is not needed anymore.
+			if (m_nextIndex != index)
+				continue;
+			if (!success)
+			{
+				// Nothing more can be read from here (end of a stream with a wrong frame
+				// count for instance). Wait for the next jump.
+				m_nextIndex = m_frameCount;
+				continue;
+			}
+			m_buffer.emplace_back(index, std::move(frame));
+			m_nextIndex++;
+		}
+	}
+}
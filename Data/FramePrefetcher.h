@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../common.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "FrameSource.h"
+
+namespace Data
+{
+	/**
+	 * \brief Decodes the frames located after the playhead on a dedicated thread, and
+	 * keeps them in a bounded buffer until they are requested.
+	 * The prefetcher uses its own frame source, so that it never has to be synchronized
+	 * with the source of the video.
+	 */
+	class FramePrefetcher
+	{
+	public:
+		explicit FramePrefetcher(int capacity);
+		~FramePrefetcher();
+		Q_DISABLE_COPY(FramePrefetcher);
+
+		/**
+		 * \brief Starts decoding from the given frame. Stops any previous decoding.
+		 * \param source Opened frame source, used by the decoding thread only.
+		 * \param firstFrameIndex Index of the first frame to decode.
+		 * \return Whether the decoding could start.
+		 */
+		bool Start(std::unique_ptr<FrameSource> source, int firstFrameIndex);
+		void Stop();
+
+		/**
+		 * \brief Tries getting the frame at the given index from the buffer. Frames
+		 * located before this index are dropped from the buffer. On a miss, the decoding
+		 * restarts right after the requested frame, since the caller is expected to
+		 * decode it itself.
+		 * \param frameIndex Index of the requested frame.
+		 * \param frame Return param for the frame.
+		 * \return Whether the frame was in the buffer.
+		 */
+		_NODISCARD bool Pop(int frameIndex, cv::Mat& frame);
+
+		_NODISCARD int GetCapacity() const;
+
+	private:
+		/**
+		 * \brief Body of the decoding thread.
+		 */
+		void Run();
+
+		/**
+		 * \brief Maximum number of decoded frames waiting in the buffer.
+		 */
+		const int m_capacity;
+		/**
+		 * \brief Frame source used by the decoding thread only.
+		 */
+		std::unique_ptr<FrameSource> m_source;
+		int m_frameCount;
+
+		std::thread m_thread;
+		/**
+		 * \brief Protects all the members below.
+		 */
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		/**
+		 * \brief Decoded frames, in increasing order of frame index.
+		 */
+		std::deque<std::pair<int, cv::Mat>> m_buffer;
+		/**
+		 * \brief Index of the next frame to decode.
+		 */
+		int m_nextIndex;
+		bool m_stopRequested;
+	};
+}
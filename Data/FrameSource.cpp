@@ -0,0 +1,13 @@
+#include "FrameSource.h"
+#include "ImageSequenceSource.h"
+#include "VideoCaptureSource.h"
+
+namespace Data
+{
+	std::unique_ptr<FrameSource> CreateFrameSource(const QString& path)
+	{
+		if (ImageSequenceSource::IsImageFile(path))
+			return std::make_unique<ImageSequenceSource>();
+		return std::make_unique<VideoCaptureSource>();
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../common.h"
+#include <memory>
+#include <opencv2/core.hpp>
+#include <QString>
+
+namespace Data
+{
+	/**
+	 * \brief Source of the frames of a video. Decouples the Video class from the way the
+	 * frames are stored on the disk (video file, image sequence...).
+	 * A frame source is used by one thread at a time. Other threads get their own source
+	 * on the same media with Clone().
+	 */
+	class FrameSource
+	{
+	public:
+		FrameSource() = default;
+		virtual ~FrameSource() = default;
+		Q_DISABLE_COPY(FrameSource);
+
+		/**
+		 * \brief Opens the media at the given path.
+		 * \return Whether the media could be opened.
+		 */
+		virtual bool Open(const QString& path) = 0;
+		/**
+		 * \brief Opens a new, independent source on the same media. Data computed when
+		 * opening this source (indices, file lists...) is shared instead of being computed
+		 * again.
+		 * \return The new source, or nullptr if it could not be opened.
+		 */
+		_NODISCARD virtual std::unique_ptr<FrameSource> Clone() const = 0;
+
+		/**
+		 * \brief Reads the frame at the given index. Reading consecutive frames is
+		 * expected to be the fastest access pattern.
+		 * \param frameIndex Index of the frame to read.
+		 * \param frame Return param for the frame.
+		 * \return Whether the frame could be read.
+		 */
+		virtual bool Read(int frameIndex, cv::Mat& frame) = 0;
+
+		_NODISCARD virtual int GetFrameCount() const = 0;
+		_NODISCARD virtual int GetFrameRate() const = 0;
+		_NODISCARD virtual int GetWidth() const = 0;
+		_NODISCARD virtual int GetHeight() const = 0;
+	};
+
+	/**
+	 * \brief Creates the frame source able to read the media at the given path: an image
+	 * sequence backend for image files, a video backend otherwise. The source is not opened.
+	 */
+	_NODISCARD std::unique_ptr<FrameSource> CreateFrameSource(const QString& path);
+}
@@ -0,0 +1,266 @@
+#include "GopIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include "../Logging/Log.h"
+
+// Reading the raw packets of a stream (to know which ones are key frames without
+// decoding them) is only supported by the FFmpeg backend of recent OpenCV versions.
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+#define HAS_RAW_STREAM_SUPPORT
+#endif
+
+namespace
+{
+	constexpr int32_t SidecarMagicNumber = 0x60b1d3c5;
+	// 1.0.2: the frame indices come from the timestamps instead of the packet order.
+	constexpr int32_t SidecarVersion = 102; // 1.0.2
+}
+
+namespace Data
+{
+	GopIndex::GopIndex() :
+		m_intraFrames(),
+		m_ready(false),
+		m_buildThread(),
+		m_cancelRequested(false)
+	{
+	}
+
+	GopIndex::~GopIndex()
+	{
+		if (m_buildThread.joinable())
+		{
+			m_cancelRequested = true;
+			m_buildThread.join();
+		}
+	}
+
+	void GopIndex::LoadOrBuild(const QString& videoPath)
+	{
+		if (LoadSidecar(videoPath))
+		{
+			m_ready = true;
+			return;
+		}
+
+		m_intraFrames.clear();
+		m_buildThread = std::thread(&GopIndex::BuildInBackground, this, videoPath);
+	}
+
+	bool GopIndex::IsReady() const
+	{
+		return m_ready;
+	}
+
+	const GopIndex::IntraFrame& GopIndex::GetIntraFrameBefore(const int frameIndex) const
+	{
+		// First I-frame strictly after the frame, then step back once. The first frame is
+		// always in the index.
+		const auto it = std::upper_bound(m_intraFrames.begin(), m_intraFrames.end(), frameIndex, [](const int frame, const IntraFrame& intraFrame)
+			{
+				return frame < intraFrame.frameIndex;
+			});
+		return it == m_intraFrames.begin() ? m_intraFrames.front() : *std::prev(it);
+	}
+
+	int GopIndex::Seek(cv::VideoCapture& capture, const int capturePosition, const int frameIndex) const
+	{
+		if (capturePosition == frameIndex)
+			return capturePosition;
+
+		// No index, or not yet: let the backend seek by itself.
+		if (!m_ready)
+		{
+			capture.set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+			return frameIndex;
+		}
+
+		// 1. Only jump when decoding forward from the current position is not possible
+		// (target behind the capture) or when the capture is in an earlier GOP.
+		int position = capturePosition;
+		const IntraFrame& intraFrame = GetIntraFrameBefore(frameIndex);
+		bool jumped = false;
+		if (position > frameIndex || position < intraFrame.frameIndex)
+		{
+			capture.set(cv::CAP_PROP_POS_MSEC, intraFrame.timestamp);
+			position = intraFrame.frameIndex;
+			jumped = true;
+		}
+
+		// 2. Decode forward up to the requested frame. grab() skips the color conversion
+		// of the frames that are not needed.
+		while (position < frameIndex && capture.grab())
+		{
+			// The first frame grabbed after a jump is the I-frame: check that the backend
+			// landed on it. When the I-frame itself is requested, checking would consume it.
+			if (jumped)
+			{
+				const double frameRate = capture.get(cv::CAP_PROP_FPS);
+				const double tolerance = frameRate > 0.0 ? 500.0 / frameRate : 1.0;
+				const double timestamp = capture.get(cv::CAP_PROP_POS_MSEC);
+				if (std::abs(timestamp - intraFrame.timestamp) > tolerance)
+				{
+					qCWarning(LogVideo) << "Seeking to the I-frame" << intraFrame.frameIndex << "landed at" << timestamp << "ms instead of" << intraFrame.timestamp << "ms -- falling back to the video backend.";
+					capture.set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+					return frameIndex;
+				}
+				jumped = false;
+			}
+			position++;
+		}
+		return position;
+	}
+
+	void GopIndex::BuildInBackground(const QString& videoPath)
+	{
+		if (!Build(videoPath))
+		{
+			if (!m_cancelRequested)
+				qCWarning(LogVideo) << "Could not build the GOP index of" << videoPath << "-- seeking will rely on the video backend.";
+			return;
+		}
+		SaveSidecar(videoPath);
+		m_ready = true;
+	}
+
+	bool GopIndex::Build(const QString& videoPath)
+	{
+#ifdef HAS_RAW_STREAM_SUPPORT
+		// Open the video in raw mode: grab() then only demuxes the packets, there is no
+		// decoding involved. This makes building the index mostly IO-bound.
+		cv::VideoCapture capture(videoPath.toStdString(), cv::CAP_FFMPEG, { cv::CAP_PROP_FORMAT, -1 });
+		if (!capture.isOpened())
+			return false;
+
+		const double frameRate = capture.get(cv::CAP_PROP_FPS);
+		if (frameRate <= 0.0)
+			return false;
+
+		// The packets come in decoding order: with B-frames, counting them would give each
+		// I-frame an index too small by the reordering delay. The index in display order
+		// is derived from the presentation timestamp instead.
+		int packetCount = 0;
+		while (capture.grab())
+		{
+			if (m_cancelRequested)
+				return false;
+			if (capture.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0.0)
+			{
+				const double timestamp = capture.get(cv::CAP_PROP_POS_MSEC);
+				m_intraFrames.push_back({ cvRound(timestamp * frameRate / 1000.0), timestamp });
+			}
+			packetCount++;
+		}
+
+		const auto byFrame = [](const IntraFrame& a, const IntraFrame& b)
+		{
+			return a.frameIndex < b.frameIndex;
+		};
+		std::sort(m_intraFrames.begin(), m_intraFrames.end(), byFrame);
+		m_intraFrames.erase(std::unique(m_intraFrames.begin(), m_intraFrames.end(), [](const IntraFrame& a, const IntraFrame& b)
+			{
+				return a.frameIndex == b.frameIndex;
+			}), m_intraFrames.end());
+
+		// The first frame of a stream is always decodable.
+		if (m_intraFrames.empty() || m_intraFrames.front().frameIndex != 0)
+			m_intraFrames.insert(m_intraFrames.begin(), { 0, 0.0 });
+
+		qCDebug(LogVideo) << "Built the GOP index of" << videoPath << ":" << m_intraFrames.size() << "I-frames for" << packetCount << "packets.";
+		return true;
+#else
+		Q_UNUSED(videoPath);
+		return false;
+#endif
+	}
+
+	bool GopIndex::LoadSidecar(const QString& videoPath)
+	{
+		/* FILE STRUCTURE.
+		 *
+		 * [int] Magic number.
+		 * [int] Data Version.
+		 * [i64] Size of the video file.
+		 * [i64] Last modification time of the video file (ms since epoch).
+		 * [int] Number of I-frames.
+		 * [lst] I-frames:
+		 *     [int] Index of the frame.
+		 *     [dbl] Timestamp of the frame (ms).
+		 */
+
+		QFile file(GetSidecarPath(videoPath));
+		if (!file.open(QIODevice::ReadOnly))
+			return false;
+		QDataStream in(&file);
+
+		int32_t magicNumber;
+		int32_t dataVersion;
+		in >> magicNumber >> dataVersion;
+		if (magicNumber != SidecarMagicNumber || dataVersion != SidecarVersion)
+			return false;
+
+		// The sidecar is only valid for the exact file it was built from.
+		const QFileInfo videoInfo(videoPath);
+		qint64 videoSize;
+		qint64 videoModificationTime;
+		in >> videoSize >> videoModificationTime;
+		if (videoSize != videoInfo.size() || videoModificationTime != videoInfo.lastModified().toMSecsSinceEpoch())
+			return false;
+
+		int32_t intraFramesCount;
+		in >> intraFramesCount;
+		if (in.status() != QDataStream::Ok || intraFramesCount <= 0)
+			return false;
+
+		m_intraFrames.resize(intraFramesCount);
+		for (IntraFrame& intraFrame : m_intraFrames)
+		{
+			int32_t index;
+			in >> index >> intraFrame.timestamp;
+			intraFrame.frameIndex = index;
+		}
+
+		const auto byFrame = [](const IntraFrame& a, const IntraFrame& b)
+		{
+			return a.frameIndex < b.frameIndex;
+		};
+		if (in.status() != QDataStream::Ok || !std::is_sorted(m_intraFrames.begin(), m_intraFrames.end(), byFrame))
+		{
+			m_intraFrames.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void GopIndex::SaveSidecar(const QString& videoPath) const
+	{
+		QFile file(GetSidecarPath(videoPath));
+		if (!file.open(QIODevice::WriteOnly))
+		{
+			qCWarning(LogVideo) << "Could not save the GOP index to" << file.fileName();
+			return;
+		}
+		QDataStream out(&file);
+
+		const QFileInfo videoInfo(videoPath);
+		out << static_cast<int32_t>(SidecarMagicNumber);
+		out << static_cast<int32_t>(SidecarVersion);
+		out << static_cast<qint64>(videoInfo.size());
+		out << static_cast<qint64>(videoInfo.lastModified().toMSecsSinceEpoch());
+		out << static_cast<int32_t>(m_intraFrames.size());
+		for (const IntraFrame& intraFrame : m_intraFrames)
+		{
+			out << static_cast<int32_t>(intraFrame.frameIndex);
+			out << intraFrame.timestamp;
+		}
+	}
+
+	QString GopIndex::GetSidecarPath(const QString& videoPath)
+	{
+		return videoPath + ".gopidx";
+	}
+}
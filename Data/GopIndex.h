@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <opencv2/videoio.hpp>
+#include <QString>
+
+namespace Data
+{
+	/**
+	 * \brief Sorted list of the intra-coded frames (I-frames) of a video, with their
+	 * timestamps. A frame can be decoded by seeking to the timestamp of the closest I-frame
+	 * before it and decoding forward from there, which is both faster and more reliable
+	 * than letting the backend seek to an arbitrary frame of a long-GOP stream: the backend
+	 * derives the timestamp of a frame from its index and the frame rate, which is wrong
+	 * for streams with a variable frame rate or gaps.
+	 * The index is saved in a sidecar file next to the video, so that it is only built
+	 * once per video. Building it reads the whole file: it is done on a background thread,
+	 * and the seeks rely on the backend until it is ready.
+	 */
+	class GopIndex
+	{
+	public:
+		GopIndex();
+		~GopIndex();
+		Q_DISABLE_COPY(GopIndex);
+
+		/**
+		 * \brief Loads the index of the given video from its sidecar file, or starts
+		 * building it (and saving the sidecar) in the background if there is no up-to-date
+		 * sidecar. Must only be called once.
+		 */
+		void LoadOrBuild(const QString& videoPath);
+		/**
+		 * \brief Whether the index is available. If not, seeks fall back to the backend.
+		 */
+		_NODISCARD bool IsReady() const;
+
+		/**
+		 * \brief Positions the capture so that its next read returns the given frame.
+		 * If the capture is already in the GOP of this frame and before it, it only
+		 * decodes forward. Otherwise it jumps to the timestamp of the I-frame starting the
+		 * GOP first, and checks that the backend landed on it.
+		 * \param capture Capture to move.
+		 * \param capturePosition Index of the frame the capture would return on its next read.
+		 * \param frameIndex Index of the frame to reach.
+		 * \return The new position of the capture (frameIndex, unless the end of the stream
+		 * was reached).
+		 */
+		int Seek(cv::VideoCapture& capture, int capturePosition, int frameIndex) const;
+
+	private:
+		struct IntraFrame
+		{
+			/**
+			 * \brief Index of the frame in display order, from its timestamp and the frame
+			 * rate.
+			 */
+			int frameIndex;
+			/**
+			 * \brief Presentation timestamp, in milliseconds, as reported by
+			 * cv::CAP_PROP_POS_MSEC.
+			 */
+			double timestamp;
+		};
+
+		/**
+		 * \brief Returns the last I-frame located at or before the given frame.
+		 */
+		_NODISCARD const IntraFrame& GetIntraFrameBefore(int frameIndex) const;
+		/**
+		 * \brief Body of the build thread.
+		 */
+		void BuildInBackground(const QString& videoPath);
+		bool Build(const QString& videoPath);
+		bool LoadSidecar(const QString& videoPath);
+		void SaveSidecar(const QString& videoPath) const;
+		_NODISCARD static QString GetSidecarPath(const QString& videoPath);
+
+		/**
+		 * \brief The I-frames of the video, in increasing order. Only written by the build
+		 * thread, and only read once m_ready is set.
+		 */
+		std::vector<IntraFrame> m_intraFrames;
+		std::atomic_bool m_ready;
+		std::thread m_buildThread;
+		std::atomic_bool m_cancelRequested;
+	};
+}
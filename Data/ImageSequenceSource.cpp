@@ -0,0 +1,217 @@
+#include "ImageSequenceSource.h"
+#include <algorithm>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QThread>
+#include "../Profiling/Profiler.h"
+#include "../Logging/Log.h"
+
+namespace
+{
+	const QStringList ImageExtensions = { "png", "jpg", "jpeg", "tif", "tiff", "bmp" };
+
+	/**
+	 * \brief Decodes one image of the sequence on the thread pool.
+	 */
+	class DecodeTask final : public QRunnable
+	{
+	public:
+		DecodeTask(QString path, std::promise<cv::Mat> promise, std::shared_ptr<std::atomic_bool> cancelled) :
+			m_path(std::move(path)),
+			m_promise(std::move(promise)),
+			m_cancelled(std::move(cancelled))
+		{
+		}
+
+		void run() override
+		{
+			if (*m_cancelled)
+			{
+				m_promise.set_value(cv::Mat());
+				return;
+			}
+			m_promise.set_value(cv::imread(m_path.toStdString(), cv::IMREAD_COLOR));
+		}
+
+	private:
+		QString m_path;
+		std::promise<cv::Mat> m_promise;
+		std::shared_ptr<std::atomic_bool> m_cancelled;
+	};
+}
+
+namespace Data
+{
+	ImageSequenceSource::ImageSequenceSource() :
+		m_files(),
+		m_width(0),
+		m_height(0),
+		m_readAheadFrames(std::max(QThread::idealThreadCount(), 1) * 2),
+		m_threadPool(std::make_shared<QThreadPool>()),
+		m_pendingFrames()
+	{
+	}
+
+	ImageSequenceSource::~ImageSequenceSource()
+	{
+		// The cancelled decodes end at once. When no clone uses the threads anymore, the
+		// decodes that did not start are also dropped, so that destroying the pool only
+		// waits for the ones running.
+		for (auto& [frameIndex, pendingFrame] : m_pendingFrames)
+		{
+			*pendingFrame.cancelled = true;
+		}
+		if (m_threadPool.use_count() == 1)
+			m_threadPool->clear();
+	}
+
+	bool ImageSequenceSource::IsImageFile(const QString& path)
+	{
+		return ImageExtensions.contains(QFileInfo(path).suffix().toLower());
+	}
+
+	bool ImageSequenceSource::Open(const QString& path)
+	{
+		const QStringList files = FindSequenceFiles(path);
+		if (files.isEmpty())
+			return false;
+
+		// All the images of a sequence are expected to have the size of the first one.
+		const cv::Mat firstImage = cv::imread(files.first().toStdString(), cv::IMREAD_COLOR);
+		if (firstImage.empty())
+			return false;
+
+		m_files = std::make_shared<const QStringList>(files);
+		m_width = firstImage.cols;
+		m_height = firstImage.rows;
+		m_pendingFrames.clear();
+		qCDebug(LogVideo) << "Opened an image sequence of" << files.size() << "frames from" << path;
+		return true;
+	}
+
+	std::unique_ptr<FrameSource> ImageSequenceSource::Clone() const
+	{
+		std::unique_ptr<ImageSequenceSource> clone = std::make_unique<ImageSequenceSource>();
+		clone->m_files = m_files;
+		clone->m_width = m_width;
+		clone->m_height = m_height;
+		clone->m_threadPool = m_threadPool;
+		return clone;
+	}
+
+	bool ImageSequenceSource::Read(const int frameIndex, cv::Mat& frame)
+	{
+		const Profiling::ScopedTimer timer("Video decode");
+
+		if (!m_files || frameIndex < 0 || frameIndex >= m_files->size())
+			return false;
+
+		UpdateReadAheadWindow(frameIndex);
+
+		const auto it = m_pendingFrames.find(frameIndex);
+		frame = it->second.image.get();
+		m_pendingFrames.erase(it);
+		if (frame.empty())
+			return false;
+
+		if (frame.cols != m_width || frame.rows != m_height)
+		{
+			qCWarning(LogVideo) << "The image" << m_files->at(frameIndex) << "is" << frame.cols << "x" << frame.rows << "instead of" << m_width << "x" << m_height << "-- resizing it.";
+			cv::resize(frame, frame, cv::Size(m_width, m_height), 0.0, 0.0, cv::INTER_AREA);
+		}
+		return true;
+	}
+
+	int ImageSequenceSource::GetFrameCount() const
+	{
+		return m_files ? m_files->size() : 0;
+	}
+
+	int ImageSequenceSource::GetFrameRate() const
+	{
+		return DefaultFrameRate;
+	}
+
+	int ImageSequenceSource::GetWidth() const
+	{
+		return m_width;
+	}
+
+	int ImageSequenceSource::GetHeight() const
+	{
+		return m_height;
+	}
+
+	QStringList ImageSequenceSource::FindSequenceFiles(const QString& path)
+	{
+		const QFileInfo fileInfo(path);
+		if (!fileInfo.exists())
+			return {};
+
+		// 1. Split the file name into a prefix, a frame number and a suffix. A file without
+		// any number is a sequence of a single image.
+		static const QRegularExpression numberedName(R"(^(.*?)(\d+)(\.[^.]+)$)");
+		const QRegularExpressionMatch nameMatch = numberedName.match(fileInfo.fileName());
+		if (!nameMatch.hasMatch())
+			return { fileInfo.absoluteFilePath() };
+		const QString prefix = nameMatch.captured(1);
+		const QString suffix = nameMatch.captured(3);
+
+		// 2. Find all the files with the same prefix and suffix, and sort them by number
+		// (not alphabetically: the numbers are not always zero-padded).
+		const QRegularExpression sequenceName("^" + QRegularExpression::escape(prefix) + R"((\d+))" + QRegularExpression::escape(suffix) + "$");
+		const QDir directory = fileInfo.absoluteDir();
+		std::vector<std::pair<qlonglong, QString>> numberedFiles;
+		for (const QString& fileName : directory.entryList({ prefix + "*" + suffix }, QDir::Files))
+		{
+			const QRegularExpressionMatch match = sequenceName.match(fileName);
+			if (match.hasMatch())
+				numberedFiles.emplace_back(match.captured(1).toLongLong(), directory.absoluteFilePath(fileName));
+		}
+		std::sort(numberedFiles.begin(), numberedFiles.end());
+
+		QStringList files;
+		files.reserve(static_cast<int>(numberedFiles.size()));
+		for (const auto& [number, filePath] : numberedFiles)
+		{
+			files.push_back(filePath);
+		}
+		return files;
+	}
+
+	void ImageSequenceSource::UpdateReadAheadWindow(const int firstFrameIndex)
+	{
+		const int lastFrameIndex = std::min(firstFrameIndex + m_readAheadFrames, static_cast<int>(m_files->size())) - 1;
+
+		// 1. Cancel the frames outside of the window (the playhead jumped).
+		for (auto it = m_pendingFrames.begin(); it != m_pendingFrames.end();)
+		{
+			if (it->first < firstFrameIndex || it->first > lastFrameIndex)
+			{
+				*it->second.cancelled = true;
+				it = m_pendingFrames.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		// 2. Schedule the frames of the window that are not being decoded yet. They are
+		// scheduled in order, so the first ones are ready first.
+		for (int frameIndex = firstFrameIndex; frameIndex <= lastFrameIndex; frameIndex++)
+		{
+			if (m_pendingFrames.count(frameIndex) != 0)
+				continue;
+
+			std::promise<cv::Mat> promise;
+			PendingFrame pendingFrame{ promise.get_future(), std::make_shared<std::atomic_bool>(false) };
+			m_threadPool->start(new DecodeTask(m_files->at(frameIndex), std::move(promise), pendingFrame.cancelled));
+			m_pendingFrames.emplace(frameIndex, std::move(pendingFrame));
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "FrameSource.h"
+#include <atomic>
+#include <future>
+#include <map>
+#include <QStringList>
+#include <QThreadPool>
+
+namespace Data
+{
+	/**
+	 * \brief Frame source reading a numbered sequence of images (shot_0001.png,
+	 * shot_0002.png...). Opening any image of the sequence opens the whole sequence.
+	 * Since every frame is a separate file, the frames are decoded in parallel on a thread
+	 * pool, a few frames ahead of the last requested one.
+	 */
+	class ImageSequenceSource final : public FrameSource
+	{
+	public:
+		/**
+		 * \brief Image files do not store any framerate: this one is used instead.
+		 */
+		static constexpr int DefaultFrameRate = 24;
+
+		ImageSequenceSource();
+		/**
+		 * \brief Cancels the frames still being decoded, instead of waiting for them.
+		 */
+		~ImageSequenceSource() override;
+
+		/**
+		 * \brief Whether the file at the given path is an image that can be opened as a
+		 * sequence.
+		 */
+		_NODISCARD static bool IsImageFile(const QString& path);
+
+		bool Open(const QString& path) override;
+		/**
+		 * \brief The clone shares the list of files and the decoding threads of this source.
+		 */
+		_NODISCARD std::unique_ptr<FrameSource> Clone() const override;
+		/**
+		 * \brief Images whose size differs from the first image of the sequence are resized
+		 * to it, since the rest of the application expects a fixed frame size.
+		 */
+		bool Read(int frameIndex, cv::Mat& frame) override;
+
+		_NODISCARD int GetFrameCount() const override;
+		_NODISCARD int GetFrameRate() const override;
+		_NODISCARD int GetWidth() const override;
+		_NODISCARD int GetHeight() const override;
+
+	private:
+		/**
+		 * \brief Decode of a frame, running or waiting on the thread pool.
+		 */
+		struct PendingFrame
+		{
+			std::future<cv::Mat> image;
+			/**
+			 * \brief Set when the frame is not needed anymore, so that the decode is
+			 * skipped if it did not start yet.
+			 */
+			std::shared_ptr<std::atomic_bool> cancelled;
+		};
+
+		/**
+		 * \brief Lists the files of the sequence the image at the given path belongs to,
+		 * sorted by frame number.
+		 */
+		_NODISCARD static QStringList FindSequenceFiles(const QString& path);
+		/**
+		 * \brief Schedules the decoding of the frames of the read-ahead window starting at
+		 * the given frame, and cancels the frames outside of it.
+		 */
+		void UpdateReadAheadWindow(int firstFrameIndex);
+
+		/**
+		 * \brief Paths of the images, in frame order. Shared with the clones of this source.
+		 */
+		std::shared_ptr<const QStringList> m_files;
+		int m_width;
+		int m_height;
+		/**
+		 * \brief Number of frames decoded in advance.
+		 */
+		int m_readAheadFrames;
+		/**
+		 * \brief Threads decoding the images. Shared with the clones of this source, so that
+		 * the sources of a video (playback, read-ahead, tracking jobs) do not each start a
+		 * thread per core.
+		 */
+		std::shared_ptr<QThreadPool> m_threadPool;
+		/**
+		 * \brief Frames being decoded. Key: frame index.
+		 */
+		std::map<int, PendingFrame> m_pendingFrames;
+	};
+}
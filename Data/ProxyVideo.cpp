@@ -0,0 +1,144 @@
+#include "ProxyVideo.h"
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <QFile>
+#include <QFileInfo>
+#include "../Logging/Log.h"
+
+namespace Data
+{
+	ProxyVideo::ProxyVideo() :
+		m_proxyPath(),
+		m_generationThread(),
+		m_ready(false),
+		m_cancelRequested(false),
+		m_capture(),
+		m_capturePosition(0)
+	{
+	}
+
+	ProxyVideo::~ProxyVideo()
+	{
+		Close();
+	}
+
+	void ProxyVideo::Open(const QString& videoPath, std::unique_ptr<FrameSource> source)
+	{
+		Close();
+		if (!source)
+			return;
+
+		m_proxyPath = GetProxyPath(videoPath);
+		if (IsUpToDate(videoPath, m_proxyPath, source->GetFrameCount()))
+		{
+			m_ready = true;
+			return;
+		}
+
+		m_cancelRequested = false;
+		m_generationThread = std::thread(&ProxyVideo::Generate, this, std::move(source), m_proxyPath);
+	}
+
+	void ProxyVideo::Close()
+	{
+		if (m_generationThread.joinable())
+		{
+			m_cancelRequested = true;
+			m_generationThread.join();
+		}
+		m_ready = false;
+		m_capture.release();
+		m_capturePosition = 0;
+	}
+
+	bool ProxyVideo::IsReady() const
+	{
+		return m_ready;
+	}
+
+	bool ProxyVideo::Read(const int frameIndex, cv::Mat& frame)
+	{
+		if (!m_ready)
+			return false;
+
+		// The proxy is opened lazily: it may have been generated by the background thread
+		// since the video was opened.
+		if (!m_capture.isOpened())
+		{
+			if (!m_capture.open(m_proxyPath.toStdString()))
+			{
+				qCWarning(LogVideo) << "Could not open the proxy" << m_proxyPath;
+				m_ready = false;
+				return false;
+			}
+			m_capturePosition = 0;
+		}
+
+		// All the frames of the proxy are intra-coded: seeking is cheap and exact.
+		if (m_capturePosition != frameIndex)
+			m_capture.set(cv::CAP_PROP_POS_FRAMES, frameIndex);
+		m_capturePosition = frameIndex;
+
+		if (!m_capture.read(frame))
+			return false;
+		m_capturePosition++;
+		return true;
+	}
+
+	void ProxyVideo::Generate(std::unique_ptr<FrameSource> source, const QString& proxyPath)
+	{
+		const double frameRate = source->GetFrameRate();
+		const cv::Size proxySize(
+			std::max(source->GetWidth() / DownscaleFactor, 1),
+			std::max(source->GetHeight() / DownscaleFactor, 1));
+
+		// Write to a temporary file first, so that an interrupted generation never leaves
+		// a truncated proxy that would look valid.
+		const QString temporaryPath = proxyPath + ".tmp.avi";
+		cv::VideoWriter writer(temporaryPath.toStdString(), cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), frameRate, proxySize);
+		if (!writer.isOpened())
+		{
+			qCWarning(LogVideo) << "Could not create the proxy" << temporaryPath;
+			return;
+		}
+
+		cv::Mat frame;
+		cv::Mat proxyFrame;
+		for (int frameIndex = 0; !m_cancelRequested && frameIndex < source->GetFrameCount() && source->Read(frameIndex, frame); frameIndex++)
+		{
+			cv::resize(frame, proxyFrame, proxySize, 0.0, 0.0, cv::INTER_AREA);
+			writer.write(proxyFrame);
+		}
+		writer.release();
+
+		if (m_cancelRequested)
+		{
+			QFile::remove(temporaryPath);
+			return;
+		}
+
+		QFile::remove(proxyPath);
+		if (!QFile::rename(temporaryPath, proxyPath))
+		{
+			qCWarning(LogVideo) << "Could not save the proxy" << proxyPath;
+			QFile::remove(temporaryPath);
+			return;
+		}
+		m_ready = true;
+	}
+
+	bool ProxyVideo::IsUpToDate(const QString& videoPath, const QString& proxyPath, const int frameCount)
+	{
+		const QFileInfo proxyInfo(proxyPath);
+		if (!proxyInfo.exists() || proxyInfo.lastModified() < QFileInfo(videoPath).lastModified())
+			return false;
+
+		const cv::VideoCapture proxy(proxyPath.toStdString());
+		return proxy.isOpened() && static_cast<int>(proxy.get(cv::CAP_PROP_FRAME_COUNT)) == frameCount;
+	}
+
+	QString ProxyVideo::GetProxyPath(const QString& videoPath)
+	{
+		return videoPath + ".proxy.avi";
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <thread>
+#include <opencv2/videoio.hpp>
+#include <QString>
+#include "FrameSource.h"
+
+namespace Data
+{
+	/**
+	 * \brief Low-resolution, intra-only copy of a video, used to display frames quickly
+	 * while the user scrubs through the timeline.
+	 * The proxy is an MJPEG file stored next to the video. It is generated once, on a
+	 * background thread, and reused as long as it is more recent than the video.
+	 */
+	class ProxyVideo
+	{
+	public:
+		/**
+		 * \brief The proxy frames are this many times smaller than the video frames, in
+		 * each dimension.
+		 */
+		static constexpr int DownscaleFactor = 4;
+
+		ProxyVideo();
+		~ProxyVideo();
+		Q_DISABLE_COPY(ProxyVideo);
+
+		/**
+		 * \brief Uses the existing proxy of the given video if it is up to date, or starts
+		 * generating it in the background otherwise.
+		 * \param videoPath Path to the full-resolution video.
+		 * \param source Opened frame source on the full-resolution video, used by the
+		 * generation thread only.
+		 */
+		void Open(const QString& videoPath, std::unique_ptr<FrameSource> source);
+		/**
+		 * \brief Closes the proxy, and cancels its generation if it is still running.
+		 */
+		void Close();
+
+		/**
+		 * \brief Whether the proxy is generated and can be read.
+		 */
+		_NODISCARD bool IsReady() const;
+		/**
+		 * \brief Reads a frame of the proxy. Must only be called once the proxy is ready.
+		 * \param frameIndex Index of the frame, in the full-resolution video.
+		 * \param frame Return param for the downscaled frame.
+		 * \return Whether the frame could be read.
+		 */
+		_NODISCARD bool Read(int frameIndex, cv::Mat& frame);
+
+	private:
+		/**
+		 * \brief Body of the generation thread.
+		 */
+		void Generate(std::unique_ptr<FrameSource> source, const QString& proxyPath);
+		_NODISCARD static bool IsUpToDate(const QString& videoPath, const QString& proxyPath, int frameCount);
+		_NODISCARD static QString GetProxyPath(const QString& videoPath);
+
+		QString m_proxyPath;
+		std::thread m_generationThread;
+		std::atomic_bool m_ready;
+		std::atomic_bool m_cancelRequested;
+		/**
+		 * \brief Capture reading the proxy file. Only opened once the proxy is ready.
+		 */
+		cv::VideoCapture m_capture;
+		/**
+		 * \brief Index of the frame m_capture will return on its next read.
+		 */
+		int m_capturePosition;
+	};
+}
@@ -1,6 +1,7 @@
 #include "TrackedPoint.h"
 #include <QDataStream>
-#include <QDebug>
+#include <QMetaMethod>
+#include "../Logging/Log.h"
 
 namespace Data
 {
@@ -21,7 +22,7 @@ namespace Data
 		m_index(other.m_index),
 		m_showInViewport(other.m_showInViewport)
 	{
-		qDebug() << "Point copied";
+		qCDebug(LogData) << "Copied point" << m_name << ".";
 	}
 
 	TrackedPoint& TrackedPoint::operator=(const TrackedPoint& other)
@@ -68,44 +69,90 @@ namespace Data
 
 	void TrackedPoint::AddKeyframe(const Keyframe& keyframe) 
 	{
-		m_keyframes[keyframe.frameIndex] = keyframe;
-		emit KeyframesChanged(m_keyframes.values());
-		qDebug() << "Added keyframe at frame " << keyframe.frameIndex << " at position " << keyframe.position;
+		m_keyframes.Set(keyframe);
+		EmitKeyframesChanged();
+		qCDebug(LogData) << "Added keyframe at frame" << keyframe.frameIndex << "at position" << keyframe.position << "to point" << m_name << ", confidence" << keyframe.confidence << ".";
 	}
 
 	bool TrackedPoint::GetKeyframe(const int index, Keyframe& keyframe)
 	{
-		const auto it = m_keyframes.find(index);
-		if (it != m_keyframes.end())
+		return m_keyframes.Find(index, keyframe);
+	}
+
+	Keyframe TrackedPoint::GetLastKeyframe(const int index)
+	{
+		Keyframe keyframe;
+		if (!m_keyframes.FindAtOrBefore(index, keyframe))
+			throw NoKeyframeFoundException(m_name, index);
+		return keyframe;
+	}
+
+	QVector<QPointF> TrackedPoint::GetPositionsAt(const QVector<int>& frames, const Interpolation interpolation) const
+	{
+		return m_keyframes.GetPositionsAt(frames, interpolation);
+	}
+
+	const TrajectoryStore& TrackedPoint::GetKeyframes() const
+	{
+		return m_keyframes;
+	}
+
+	QVector<Keyframe> TrackedPoint::GetKeyframesInRange(const int firstFrame, const int lastFrame) const
+	{
+		QVector<Keyframe> keyframes;
+		for (auto it = m_keyframes.LowerBound(firstFrame); it != m_keyframes.end() && it.GetFrameIndex() <= lastFrame; ++it)
 		{
-			keyframe = it.value();
-			return true;
+			keyframes.push_back(*it);
 		}
-		return false;
+		return keyframes;
+	}
+
+	void TrackedPoint::RemoveKeyframesInRange(const int firstFrame, const int lastFrame)
+	{
+		m_keyframes.RemoveRange(firstFrame, lastFrame);
+		EmitKeyframesChanged();
 	}
 
-	const Keyframe& TrackedPoint::GetLastKeyframe(const int index)
+	int TrackedPoint::GetTrackedRunEnd(const int frameIndex) const
 	{
-		int currentIndex = index;
-		while(currentIndex >= 0)
+		int runEnd = frameIndex;
+		const auto first = m_keyframes.LowerBound(frameIndex + 1);
+		if (first == m_keyframes.end())
+			return runEnd;
+
+		const int seedFrame = (*first).seedFrame;
+		for (auto it = first; it != m_keyframes.end(); ++it)
 		{
-			const auto it = m_keyframes.find(currentIndex);
-			if (it != m_keyframes.end())
-				return it.value();
-			currentIndex--;
+			// The runs are contiguous: a gap means the next keyframes come from elsewhere.
+			const Keyframe keyframe = *it;
+			if (keyframe.source != KeyframeSource::Tracked || keyframe.seedFrame != seedFrame || keyframe.frameIndex != runEnd + 1)
+				break;
+			runEnd = keyframe.frameIndex;
 		}
-		throw NoKeyframeFoundException(m_name, index);
+		return runEnd;
 	}
 
-	const QMap<int, Keyframe>& TrackedPoint::GetKeyframes() const
+	QVector<int> TrackedPoint::GetManualKeyframeIndices() const
 	{
-		return m_keyframes;
+		QVector<int> indices;
+		for (const Keyframe& keyframe : m_keyframes)
+		{
+			if (keyframe.source == KeyframeSource::Manual)
+				indices.push_back(keyframe.frameIndex);
+		}
+		return indices;
 	}
 
 	void TrackedPoint::ClearKeyframes()
 	{
-		m_keyframes.clear();
-		emit KeyframesChanged(QList<Keyframe>());
+		m_keyframes.Clear();
+		EmitKeyframesChanged();
+	}
+
+	void TrackedPoint::EmitKeyframesChanged()
+	{
+		if (isSignalConnected(QMetaMethod::fromSignal(&TrackedPoint::KeyframesChanged)))
+			emit KeyframesChanged(m_keyframes.GetValues());
 	}
 
 	const QColor& TrackedPoint::GetColor() const
@@ -157,17 +204,20 @@ namespace Data
 		out << m_color;
 		out << m_showInViewport;
 
-		out << m_keyframes.size();
-		for (const int key : m_keyframes.keys())
+		out << static_cast<int32_t>(m_keyframes.GetSize());
+		for (const auto& [position, frameIndex, source, confidence, seedFrame] : m_keyframes)
 		{
-			out << static_cast<int32_t>(key); // Cast for clarity, but "useless".
-			const auto& [position, frameIndex] = m_keyframes[key];
-			out << static_cast<int32_t>(frameIndex); // Again.
+			// The key of the keyframe, then the keyframe: the format predates the store.
+			out << static_cast<int32_t>(frameIndex);
+			out << static_cast<int32_t>(frameIndex);
 			out << position;
+			out << static_cast<int32_t>(source);
+			out << confidence;
+			out << static_cast<int32_t>(seedFrame);
 		}
 	}
 
-	void TrackedPoint::Load(QDataStream& in)
+	void TrackedPoint::Load(QDataStream& in, const int32_t dataVersion)
 	{
 		// The name and index are loaded by the document.
 
@@ -180,14 +230,31 @@ namespace Data
 		in >> keyframesCount;
 		for(int i = 0; i < keyframesCount; i++)
 		{
+			// The key duplicates the frame index of the keyframe.
 			int32_t key;
 			in >> key;
 
 			Keyframe keyframe;
 			in >> keyframe.frameIndex;
 			in >> keyframe.position;
-			m_keyframes[key] = keyframe;
+			// Before 1.0.1, the source of the keyframes was not saved: they are considered
+			// manual, so that they are never overwritten by a segment tracking.
+			if (dataVersion >= 101)
+			{
+				int32_t source;
+				in >> source;
+				keyframe.source = static_cast<KeyframeSource>(source);
+			}
+			if (dataVersion >= 102)
+				in >> keyframe.confidence;
+			// Before 1.0.3, the seed frames were not saved: the consecutive tracked keyframes
+			// are then considered as a single run.
+			if (dataVersion >= 103)
+				in >> keyframe.seedFrame;
+			keyframe.frameIndex = key;
+			m_keyframes.Set(keyframe);
 		}
+		EmitKeyframesChanged();
 
 	}
 
@@ -195,7 +262,7 @@ namespace Data
 	{
 		std::unique_ptr<TrackedPoint> point = std::make_unique<TrackedPoint>(m_name, m_index);
 		point->m_color = m_color;
-		point->m_keyframes = m_keyframes; // note: QMap is copy on write
+		point->m_keyframes = m_keyframes;
 		point->m_showInViewport = m_showInViewport;
 		return point;
 	}
@@ -4,28 +4,12 @@
 #include <memory>
 #include <QVector2D>
 #include <QColor>
-#include <QMap>
 #include <QObject>
+#include "TrajectoryStore.h"
 
 namespace Data
 {
 
-	/**
-	 * \brief A keyframe stores the position of a point on the screen
-	 *  at a given point in time.
-	 */
-	struct Keyframe
-	{
-		/**
-		 * \brief Position of the point on the screen.
-		 */
-		QPoint position{ 0, 0 };
-		/**
-		 * \brief Index at which the point is at this position.
-		 */
-		int frameIndex{ 0 };
-	};
-
 	class NoKeyframeFoundException final : public std::exception
 	{
 	public:
@@ -76,12 +60,28 @@ namespace Data
 		 * \brief Used to return the first keyframe that can be found starting from the given
 		 * index, and going backwards. This is used for instance by trackers to know which
 		 * position to use to start tracking.
-		 * If no keyframe is found, there will be a 
+		 * If no keyframe is found, a NoKeyframeFoundException is thrown.
 		 * \param index Index of the first frame to try.
 		 * \return Return the first found keyframe.
 		 */
-		const Keyframe& GetLastKeyframe(int index);
-		_NODISCARD const QMap<int, Keyframe>& GetKeyframes() const;
+		Keyframe GetLastKeyframe(int index);
+		_NODISCARD const TrajectoryStore& GetKeyframes() const;
+		/**
+		 * \brief Positions of the point on the given frames, computed in a single pass over
+		 * the keyframes rather than with a lookup per frame.
+		 * \param frames Frames to evaluate, in increasing order.
+		 * \return One position per frame, or nothing if the point has no keyframe.
+		 */
+		_NODISCARD QVector<QPointF> GetPositionsAt(const QVector<int>& frames, Interpolation interpolation) const;
+
+		/**
+		 * \brief Keyframes located between the given frames (inclusive), in frame order.
+		 */
+		_NODISCARD QVector<Keyframe> GetKeyframesInRange(int firstFrame, int lastFrame) const;
+		/**
+		 * \brief Removes the keyframes located between the given frames (inclusive).
+		 */
+		void RemoveKeyframesInRange(int firstFrame, int lastFrame);
 
 		void ClearKeyframes();
 
@@ -97,8 +97,24 @@ namespace Data
 		_NODISCARD bool IsVisibleInViewport() const;
 		void SetVisibleInViewport(bool visible);
 
+		/**
+		 * \brief Last frame of the tracked keyframes that directly follow the given frame
+		 * and were tracked in the same run (from the same seed frame). These are the
+		 * keyframes to track again when the keyframe on the given frame is corrected.
+		 * \return The given frame if the next keyframe is not a tracked one.
+		 */
+		_NODISCARD int GetTrackedRunEnd(int frameIndex) const;
+		/**
+		 * \brief Indices of the frames holding a manual keyframe, in increasing order.
+		 */
+		_NODISCARD QVector<int> GetManualKeyframeIndices() const;
+
 		void Save(QDataStream& out) const;
-		void Load(QDataStream& in);
+		/**
+		 * \param dataVersion Version of the document being loaded, to read the files of
+		 * older versions.
+		 */
+		void Load(QDataStream& in, int32_t dataVersion);
 
 		/**
 		 * \brief Explicit copy method. Way way WAY less error-prone than copy constructors and all.
@@ -112,20 +128,23 @@ namespace Data
 		void KeyframesChanged(QList<Keyframe> keyframes);
 
 	private:
+		/**
+		 * \brief Emits KeyframesChanged, if anything is connected to it: building the list
+		 * of the keyframes is not free.
+		 */
+		void EmitKeyframesChanged();
+
 		/**
 		 * \brief Name of this tracked point, as displayed in the UI. There
 		 * is no requirement that a tracked point's name must be unique.
 		 */
 		QString m_name;
 		/**
-		 * \brief Map of the different keyframes of this tracked point.
-		 * Key: frame index. Value: the keyframe.
-		 * Use a map and not a hash because we're often interested in getting the
-		 * SORTED keys.
-		 * This structure allows to have a sparse storage of the keyframes.
-		 * This saves memory for large videos.
+		 * \brief The different keyframes of this tracked point, sorted by frame.
+		 * The tracked runs are stored densely and the manual keyframes sparsely, so that
+		 * looking a frame up and going through the keyframes stay cheap on long videos.
 		 */
-		QMap<int, Keyframe> m_keyframes;
+		TrajectoryStore m_keyframes;
 		/**
 		 * \brief Color of the tracked point in the UI.
 		 */
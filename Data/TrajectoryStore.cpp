@@ -0,0 +1,537 @@
+#include "TrajectoryStore.h"
+#include <algorithm>
+#include <QVector2D>
+
+namespace
+{
+	/**
+	 * \brief Index of the lowest set bit of a non-zero word.
+	 */
+	int LowestBit(uint64_t word)
+	{
+		int bit = 0;
+		for (int shift = 32; shift > 0; shift /= 2)
+		{
+			if ((word & ((uint64_t{ 1 } << shift) - 1)) == 0)
+			{
+				word >>= shift;
+				bit += shift;
+			}
+		}
+		return bit;
+	}
+
+	/**
+	 * \brief Index of the highest set bit of a non-zero word.
+	 */
+	int HighestBit(uint64_t word)
+	{
+		int bit = 0;
+		for (int shift = 32; shift > 0; shift /= 2)
+		{
+			if (word >> shift)
+			{
+				word >>= shift;
+				bit += shift;
+			}
+		}
+		return bit;
+	}
+}
+
+namespace Data
+{
+	TrajectoryStore::ConstIterator::ConstIterator(const TrajectoryStore& store, const int denseOffset, const int sparseIndex) :
+		m_store(&store),
+		m_denseOffset(denseOffset),
+		m_sparseIndex(sparseIndex)
+	{
+	}
+
+	bool TrajectoryStore::ConstIterator::IsDense() const
+	{
+		if (m_denseOffset >= m_store->GetDenseSize())
+			return false;
+		if (m_sparseIndex >= static_cast<int>(m_store->m_sparse.size()))
+			return true;
+		return m_store->m_denseFirstFrame + m_denseOffset < m_store->m_sparse[m_sparseIndex].frameIndex;
+	}
+
+	Keyframe TrajectoryStore::ConstIterator::operator*() const
+	{
+		return IsDense() ? m_store->GetDenseKeyframe(m_denseOffset) : m_store->m_sparse[m_sparseIndex];
+	}
+
+	TrajectoryStore::ConstIterator& TrajectoryStore::ConstIterator::operator++()
+	{
+		if (IsDense())
+			m_denseOffset = m_store->FindDensePresent(m_denseOffset + 1);
+		else
+			m_sparseIndex++;
+		return *this;
+	}
+
+	bool TrajectoryStore::ConstIterator::operator==(const ConstIterator& other) const
+	{
+		return m_store == other.m_store && m_denseOffset == other.m_denseOffset && m_sparseIndex == other.m_sparseIndex;
+	}
+
+	bool TrajectoryStore::ConstIterator::operator!=(const ConstIterator& other) const
+	{
+		return !(*this == other);
+	}
+
+	int TrajectoryStore::ConstIterator::GetFrameIndex() const
+	{
+		return IsDense() ? m_store->m_denseFirstFrame + m_denseOffset : m_store->m_sparse[m_sparseIndex].frameIndex;
+	}
+
+	TrajectoryStore::TrajectoryStore() :
+		m_denseFirstFrame(0),
+		m_denseChunks(),
+		m_presenceSummary(),
+		m_denseCount(0),
+		m_sparse()
+	{
+	}
+
+	void TrajectoryStore::Set(const Keyframe& keyframe)
+	{
+		if (keyframe.source == KeyframeSource::Manual)
+		{
+			const int offset = keyframe.frameIndex - m_denseFirstFrame;
+			if (offset >= 0 && offset < GetDenseSize() && IsDensePresent(offset))
+			{
+				SetDensePresent(offset, false);
+				TrimDense();
+			}
+
+			const int index = SparseLowerBound(keyframe.frameIndex);
+			if (index < static_cast<int>(m_sparse.size()) && m_sparse[index].frameIndex == keyframe.frameIndex)
+				m_sparse[index] = keyframe;
+			else
+				m_sparse.insert(m_sparse.begin() + index, keyframe);
+			return;
+		}
+
+		RemoveSparse(keyframe.frameIndex);
+		ReserveDenseFrame(keyframe.frameIndex);
+		const int offset = keyframe.frameIndex - m_denseFirstFrame;
+		DenseChunk& chunk = *m_denseChunks[offset / ChunkFrames];
+		const int index = offset % ChunkFrames;
+		chunk.x[index] = keyframe.position.x();
+		chunk.y[index] = keyframe.position.y();
+		chunk.confidence[index] = keyframe.confidence;
+		chunk.seedFrame[index] = keyframe.seedFrame;
+		SetDensePresent(offset, true);
+	}
+
+	bool TrajectoryStore::Find(const int frameIndex, Keyframe& keyframe) const
+	{
+		const int offset = frameIndex - m_denseFirstFrame;
+		if (offset >= 0 && offset < GetDenseSize() && IsDensePresent(offset))
+		{
+			keyframe = GetDenseKeyframe(offset);
+			return true;
+		}
+
+		const int index = SparseLowerBound(frameIndex);
+		if (index < static_cast<int>(m_sparse.size()) && m_sparse[index].frameIndex == frameIndex)
+		{
+			keyframe = m_sparse[index];
+			return true;
+		}
+		return false;
+	}
+
+	bool TrajectoryStore::Contains(const int frameIndex) const
+	{
+		Keyframe keyframe;
+		return Find(frameIndex, keyframe);
+	}
+
+	bool TrajectoryStore::FindAtOrBefore(const int frameIndex, Keyframe& keyframe) const
+	{
+		const int denseOffset = FindLastDensePresent(std::min(frameIndex - m_denseFirstFrame, GetDenseSize() - 1));
+		const int sparseIndex = SparseLowerBound(frameIndex + 1) - 1;
+		if (denseOffset < 0 && sparseIndex < 0)
+			return false;
+
+		// A frame is never both dense and sparse: the latest of the two is the one.
+		if (sparseIndex < 0 || (denseOffset >= 0 && m_denseFirstFrame + denseOffset > m_sparse[sparseIndex].frameIndex))
+			keyframe = GetDenseKeyframe(denseOffset);
+		else
+			keyframe = m_sparse[sparseIndex];
+		return true;
+	}
+
+	QVector<QPointF> TrajectoryStore::GetPositionsAt(const QVector<int>& frames, const Interpolation interpolation) const
+	{
+		QVector<QPointF> positions;
+		if (IsEmpty())
+			return positions;
+		positions.reserve(frames.size());
+
+		// Sliding window on the keyframes around the current frame: the two last ones on it or
+		// before it, and the two first ones after it.
+		Keyframe beforePrevious;
+		Keyframe previous;
+		int previousCount = 0;
+		ConstIterator nextIt = begin();
+		Keyframe next = *nextIt;
+		Keyframe afterNext;
+		bool hasAfterNext = false;
+		bool nextChanged = true;
+		for (const int frame : frames)
+		{
+			while (nextIt != end() && nextIt.GetFrameIndex() <= frame)
+			{
+				beforePrevious = previous;
+				previous = next;
+				previousCount = std::min(previousCount + 1, 2);
+				++nextIt;
+				if (nextIt != end())
+					next = *nextIt;
+				nextChanged = true;
+			}
+
+			if (previousCount == 0)
+			{
+				positions.push_back(next.position);
+				continue;
+			}
+			if (nextIt == end() || interpolation == Interpolation::Hold || previous.frameIndex == frame)
+			{
+				positions.push_back(previous.position);
+				continue;
+			}
+
+			const float span = static_cast<float>(next.frameIndex - previous.frameIndex);
+			const float t = static_cast<float>(frame - previous.frameIndex) / span;
+			const QVector2D p0(previous.position);
+			const QVector2D p1(next.position);
+			if (interpolation == Interpolation::Linear)
+			{
+				positions.push_back((p0 + (p1 - p0) * t).toPointF());
+				continue;
+			}
+
+			if (nextChanged)
+			{
+				ConstIterator afterNextIt = nextIt;
+				++afterNextIt;
+				hasAfterNext = afterNextIt != end();
+				if (hasAfterNext)
+					afterNext = *afterNextIt;
+				nextChanged = false;
+			}
+
+			// Tangents in pixels per frame, one-sided at the ends of the trajectory.
+			const QVector2D m0 = previousCount == 2
+				? (p1 - QVector2D(beforePrevious.position)) / static_cast<float>(next.frameIndex - beforePrevious.frameIndex)
+				: (p1 - p0) / span;
+			const QVector2D m1 = hasAfterNext
+				? (QVector2D(afterNext.position) - p0) / static_cast<float>(afterNext.frameIndex - previous.frameIndex)
+				: (p1 - p0) / span;
+			const float t2 = t * t;
+			const float t3 = t2 * t;
+			const QVector2D position =
+				p0 * (2.0f * t3 - 3.0f * t2 + 1.0f)
+				+ m0 * (span * (t3 - 2.0f * t2 + t))
+				+ p1 * (-2.0f * t3 + 3.0f * t2)
+				+ m1 * (span * (t3 - t2));
+			positions.push_back(position.toPointF());
+		}
+		return positions;
+	}
+
+	void TrajectoryStore::RemoveRange(const int firstFrame, const int lastFrame)
+	{
+		if (lastFrame < firstFrame)
+			return;
+
+		const int firstOffset = std::max(firstFrame - m_denseFirstFrame, 0);
+		const int lastOffset = std::min(lastFrame - m_denseFirstFrame, GetDenseSize() - 1);
+		for (int offset = FindDensePresent(firstOffset); offset <= lastOffset; offset = FindDensePresent(offset + 1))
+		{
+			SetDensePresent(offset, false);
+		}
+		TrimDense();
+
+		const auto first = m_sparse.begin() + SparseLowerBound(firstFrame);
+		const auto last = m_sparse.begin() + SparseLowerBound(lastFrame + 1);
+		m_sparse.erase(first, last);
+	}
+
+	void TrajectoryStore::Clear()
+	{
+		ClearDense();
+		m_sparse.clear();
+	}
+
+	int TrajectoryStore::GetSize() const
+	{
+		return m_denseCount + static_cast<int>(m_sparse.size());
+	}
+
+	bool TrajectoryStore::IsEmpty() const
+	{
+		return GetSize() == 0;
+	}
+
+	TrajectoryStore::ConstIterator TrajectoryStore::begin() const
+	{
+		return ConstIterator(*this, FindDensePresent(0), 0);
+	}
+
+	TrajectoryStore::ConstIterator TrajectoryStore::end() const
+	{
+		return ConstIterator(*this, GetDenseSize(), static_cast<int>(m_sparse.size()));
+	}
+
+	TrajectoryStore::ConstIterator TrajectoryStore::LowerBound(const int frameIndex) const
+	{
+		const int offset = std::clamp(frameIndex - m_denseFirstFrame, 0, GetDenseSize());
+		return ConstIterator(*this, FindDensePresent(offset), SparseLowerBound(frameIndex));
+	}
+
+	QList<Keyframe> TrajectoryStore::GetValues() const
+	{
+		QList<Keyframe> values;
+		values.reserve(GetSize());
+		for (const Keyframe& keyframe : *this)
+		{
+			values.push_back(keyframe);
+		}
+		return values;
+	}
+
+	int TrajectoryStore::GetDenseSize() const
+	{
+		return static_cast<int>(m_denseChunks.size()) * ChunkFrames;
+	}
+
+	bool TrajectoryStore::IsDensePresent(const int offset) const
+	{
+		return (GetPresenceWord(0, offset / WordBits) >> (offset % WordBits)) & 1u;
+	}
+
+	void TrajectoryStore::SetDensePresent(const int offset, const bool present)
+	{
+		if (IsDensePresent(offset) == present)
+			return;
+
+		// The chunk exists: it was reserved, or it holds the keyframe being removed.
+		std::unique_ptr<DenseChunk>& chunk = m_denseChunks[offset / ChunkFrames];
+		chunk->count += present ? 1 : -1;
+		m_denseCount += present ? 1 : -1;
+
+		// Go up the summary levels as long as a word changes from empty to not empty, or
+		// the other way around.
+		int index = offset;
+		for (size_t level = 0; level <= m_presenceSummary.size(); ++level)
+		{
+			uint64_t& word = level == 0 ? chunk->presence[(offset % ChunkFrames) / WordBits] : m_presenceSummary[level - 1][index / WordBits];
+			const bool wasEmpty = word == 0;
+			const uint64_t bit = uint64_t{ 1 } << (index % WordBits);
+			if (present)
+				word |= bit;
+			else
+				word &= ~bit;
+			if (wasEmpty == (word == 0))
+				break;
+			index /= WordBits;
+		}
+
+		if (chunk->count == 0)
+			chunk.reset();
+	}
+
+	int TrajectoryStore::FindDensePresent(const int offset) const
+	{
+		if (offset >= GetDenseSize())
+			return GetDenseSize();
+		const int found = FindPresentBit(0, offset);
+		return found < 0 ? GetDenseSize() : found;
+	}
+
+	int TrajectoryStore::FindLastDensePresent(const int offset) const
+	{
+		return FindLastPresentBit(0, offset);
+	}
+
+	int TrajectoryStore::FindPresentBit(const size_t level, const int index) const
+	{
+		const int wordIndex = index / WordBits;
+		if (wordIndex >= GetPresenceWordCount(level))
+			return -1;
+
+		const uint64_t word = GetPresenceWord(level, wordIndex) & (~uint64_t{ 0 } << (index % WordBits));
+		if (word != 0)
+			return wordIndex * WordBits + LowestBit(word);
+		// The top level has a single word: there is nothing after it.
+		if (level == m_presenceSummary.size())
+			return -1;
+
+		const int nextWord = FindPresentBit(level + 1, wordIndex + 1);
+		return nextWord < 0 ? -1 : nextWord * WordBits + LowestBit(GetPresenceWord(level, nextWord));
+	}
+
+	int TrajectoryStore::FindLastPresentBit(const size_t level, const int index) const
+	{
+		if (index < 0)
+			return -1;
+
+		const int wordIndex = index / WordBits;
+		const uint64_t word = GetPresenceWord(level, wordIndex) & (~uint64_t{ 0 } >> (WordBits - 1 - index % WordBits));
+		if (word != 0)
+			return wordIndex * WordBits + HighestBit(word);
+		if (level == m_presenceSummary.size())
+			return -1;
+
+		const int previousWord = FindLastPresentBit(level + 1, wordIndex - 1);
+		return previousWord < 0 ? -1 : previousWord * WordBits + HighestBit(GetPresenceWord(level, previousWord));
+	}
+
+	uint64_t TrajectoryStore::GetPresenceWord(const size_t level, const int index) const
+	{
+		if (level > 0)
+			return m_presenceSummary[level - 1][index];
+		const std::unique_ptr<DenseChunk>& chunk = m_denseChunks[index / ChunkWords];
+		return chunk ? chunk->presence[index % ChunkWords] : 0;
+	}
+
+	int TrajectoryStore::GetPresenceWordCount(const size_t level) const
+	{
+		return level == 0 ? static_cast<int>(m_denseChunks.size()) * ChunkWords : static_cast<int>(m_presenceSummary[level - 1].size());
+	}
+
+	void TrajectoryStore::ResizePresenceSummary()
+	{
+		size_t level = 1;
+		for (int wordCount = GetPresenceWordCount(0); wordCount > 1; wordCount = (wordCount + WordBits - 1) / WordBits)
+		{
+			const size_t summaryWordCount = static_cast<size_t>((wordCount + WordBits - 1) / WordBits);
+			if (level > m_presenceSummary.size())
+			{
+				// A new top level: its words are not only the added ones.
+				m_presenceSummary.emplace_back(summaryWordCount, 0);
+				for (int i = 0; i < wordCount; ++i)
+				{
+					if (GetPresenceWord(level - 1, i) != 0)
+						m_presenceSummary.back()[i / WordBits] |= uint64_t{ 1 } << (i % WordBits);
+				}
+			}
+			else
+				m_presenceSummary[level - 1].resize(summaryWordCount, 0);
+			level++;
+		}
+		m_presenceSummary.resize(level - 1);
+	}
+
+	void TrajectoryStore::RebuildPresenceSummary()
+	{
+		m_presenceSummary.clear();
+		ResizePresenceSummary();
+	}
+
+	void TrajectoryStore::ReserveDenseFrame(const int frameIndex)
+	{
+		if (m_denseChunks.empty())
+			m_denseFirstFrame = AlignToChunk(frameIndex);
+
+		if (frameIndex < m_denseFirstFrame)
+		{
+			const int newFirstFrame = AlignToChunk(frameIndex);
+			// The chunks cannot be copied: add the null ones at the end, then rotate them in.
+			const size_t added = static_cast<size_t>((m_denseFirstFrame - newFirstFrame) / ChunkFrames);
+			m_denseChunks.resize(m_denseChunks.size() + added);
+			std::rotate(m_denseChunks.begin(), m_denseChunks.end() - added, m_denseChunks.end());
+			m_denseFirstFrame = newFirstFrame;
+			// The summaries do not shift by whole words.
+			RebuildPresenceSummary();
+		}
+
+		const int chunkCount = (frameIndex - m_denseFirstFrame) / ChunkFrames + 1;
+		if (chunkCount > static_cast<int>(m_denseChunks.size()))
+		{
+			m_denseChunks.resize(chunkCount);
+			// The added words are empty: the summaries only need to cover them.
+			ResizePresenceSummary();
+		}
+
+		std::unique_ptr<DenseChunk>& chunk = m_denseChunks[chunkCount - 1];
+		if (!chunk)
+			chunk = std::make_unique<DenseChunk>();
+	}
+
+	void TrajectoryStore::TrimDense()
+	{
+		if (m_denseCount == 0)
+		{
+			ClearDense();
+			return;
+		}
+
+		// The chunks are freed when their last keyframe is removed: drop the empty ones at
+		// both ends, so that looking up a frame outside of the keyframes stops at once.
+		const auto first = std::find_if(m_denseChunks.begin(), m_denseChunks.end(), [](const std::unique_ptr<DenseChunk>& chunk)
+			{
+				return chunk != nullptr;
+			});
+		if (first != m_denseChunks.begin())
+		{
+			m_denseFirstFrame += static_cast<int>(first - m_denseChunks.begin()) * ChunkFrames;
+			m_denseChunks.erase(m_denseChunks.begin(), first);
+			RebuildPresenceSummary();
+		}
+		while (!m_denseChunks.back())
+		{
+			m_denseChunks.pop_back();
+		}
+		ResizePresenceSummary();
+	}
+
+	void TrajectoryStore::ClearDense()
+	{
+		m_denseFirstFrame = 0;
+		m_denseChunks.clear();
+		m_presenceSummary.clear();
+		m_denseCount = 0;
+	}
+
+	int TrajectoryStore::AlignToChunk(const int frameIndex)
+	{
+		// Round towards minus infinity, for negative frames too.
+		return frameIndex - ((frameIndex % ChunkFrames) + ChunkFrames) % ChunkFrames;
+	}
+
+	Keyframe TrajectoryStore::GetDenseKeyframe(const int offset) const
+	{
+		const DenseChunk& chunk = *m_denseChunks[offset / ChunkFrames];
+		const int index = offset % ChunkFrames;
+		Keyframe keyframe;
+		keyframe.position = QPoint(chunk.x[index], chunk.y[index]);
+		keyframe.frameIndex = m_denseFirstFrame + offset;
+		keyframe.source = KeyframeSource::Tracked;
+		keyframe.confidence = chunk.confidence[index];
+		keyframe.seedFrame = chunk.seedFrame[index];
+		return keyframe;
+	}
+
+	int TrajectoryStore::SparseLowerBound(const int frameIndex) const
+	{
+		const auto it = std::lower_bound(m_sparse.cbegin(), m_sparse.cend(), frameIndex, [](const Keyframe& keyframe, const int frame)
+		{
+			return keyframe.frameIndex < frame;
+		});
+		return static_cast<int>(it - m_sparse.cbegin());
+	}
+
+	void TrajectoryStore::RemoveSparse(const int frameIndex)
+	{
+		const int index = SparseLowerBound(frameIndex);
+		if (index < static_cast<int>(m_sparse.size()) && m_sparse[index].frameIndex == frameIndex)
+			m_sparse.erase(m_sparse.begin() + index);
+	}
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "../common.h"
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <QList>
+#include <QPoint>
+#include <QPointF>
+#include <QVector>
+
+namespace Data
+{
+	/**
+	 * \brief Where the position of a keyframe comes from.
+	 */
+	enum class KeyframeSource : int32_t
+	{
+		/**
+		 * \brief Placed by the user. Manual keyframes split the timeline into segments that
+		 * can be tracked independently.
+		 */
+		Manual = 0,
+		/**
+		 * \brief Found by an automatic tracker.
+		 */
+		Tracked = 1
+	};
+
+	/**
+	 * \brief A keyframe stores the position of a point on the screen
+	 *  at a given point in time.
+	 */
+	struct Keyframe
+	{
+		/**
+		 * \brief Position of the point on the screen.
+		 */
+		QPoint position{ 0, 0 };
+		/**
+		 * \brief Index at which the point is at this position.
+		 */
+		int frameIndex{ 0 };
+		KeyframeSource source{ KeyframeSource::Manual };
+		/**
+		 * \brief Confidence of the tracker in the position, between 0 and 1. Always 1 for
+		 * manual keyframes.
+		 */
+		float confidence{ 1.0f };
+		/**
+		 * \brief For tracked keyframes, frame the tracker was started from. The keyframes
+		 * tracked together share it, which tells the runs of the trackers apart. -1 for
+		 * manual keyframes.
+		 */
+		int seedFrame{ -1 };
+	};
+
+	/**
+	 * \brief How the position of a point is computed between two keyframes.
+	 */
+	enum class Interpolation
+	{
+		/**
+		 * \brief Position of the previous keyframe.
+		 */
+		Hold,
+		Linear,
+		/**
+		 * \brief Cubic Hermite spline, with the tangents of a Catmull-Rom spline scaled to
+		 * the spacing of the keyframes.
+		 */
+		Cubic
+	};
+
+	/**
+	 * \brief Keyframes of a tracked point, at most one per frame, in frame order.
+	 * The tracked keyframes come in long runs with one keyframe per frame: they are stored
+	 * densely, one column per field indexed by frame, with a bitmap telling which frames
+	 * hold a keyframe. Looking a frame up is then an index computation, and going through
+	 * the keyframes reads contiguous memory. The columns are split into fixed-size chunks,
+	 * only allocated where there are keyframes, so that the memory used follows the number
+	 * of tracked frames and not the distance between the runs. Each word of the bitmap is summarized by a bit
+	 * telling whether it is empty, and so on up to a single word, so that the gaps between
+	 * the keyframes are skipped in logarithmic time. The manual keyframes are few and far apart:
+	 * they are stored as a vector sorted by frame, where they cost nothing for the frames
+	 * between them.
+	 * The keyframes are not stored as Keyframe objects: they are built on access, and
+	 * returned by value.
+	 */
+	class TrajectoryStore
+	{
+	public:
+		/**
+		 * \brief Forward iterator on the keyframes, in frame order. Merges the dense and
+		 * the sparse keyframes on the fly.
+		 */
+		class ConstIterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = Keyframe;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = Keyframe;
+
+			_NODISCARD Keyframe operator*() const;
+			ConstIterator& operator++();
+			_NODISCARD bool operator==(const ConstIterator& other) const;
+			_NODISCARD bool operator!=(const ConstIterator& other) const;
+
+			/**
+			 * \brief Frame of the keyframe, without building it.
+			 */
+			_NODISCARD int GetFrameIndex() const;
+
+		private:
+			friend class TrajectoryStore;
+
+			/**
+			 * \param denseOffset Offset of a present dense keyframe, or the size of the dense
+			 * columns.
+			 */
+			ConstIterator(const TrajectoryStore& store, int denseOffset, int sparseIndex);
+			_NODISCARD bool IsDense() const;
+
+			const TrajectoryStore* m_store;
+			int m_denseOffset;
+			int m_sparseIndex;
+		};
+
+		TrajectoryStore();
+
+		/**
+		 * \brief Adds the keyframe, replacing the one on its frame if any.
+		 */
+		void Set(const Keyframe& keyframe);
+		/**
+		 * \brief Tries returning the keyframe on the given frame.
+		 * \param keyframe Return param for the keyframe.
+		 * \return Whether there is a keyframe on the frame.
+		 */
+		_NODISCARD bool Find(int frameIndex, Keyframe& keyframe) const;
+		_NODISCARD bool Contains(int frameIndex) const;
+		/**
+		 * \brief Tries returning the last keyframe on the given frame or before it.
+		 * Logarithmic in the number of manual keyframes and in the number of frames covered by
+		 * the tracked ones.
+		 * \param keyframe Return param for the keyframe.
+		 * \return Whether there is such a keyframe.
+		 */
+		_NODISCARD bool FindAtOrBefore(int frameIndex, Keyframe& keyframe) const;
+		/**
+		 * \brief Positions of the point on the given frames, in a single pass over the
+		 * keyframes. Before the first keyframe and after the last one, the position is the
+		 * one of that keyframe.
+		 * \param frames Frames to evaluate, in increasing order.
+		 * \return One position per frame, or nothing if there is no keyframe.
+		 */
+		_NODISCARD QVector<QPointF> GetPositionsAt(const QVector<int>& frames, Interpolation interpolation) const;
+		/**
+		 * \brief Removes the keyframes located between the given frames (inclusive).
+		 */
+		void RemoveRange(int firstFrame, int lastFrame);
+		void Clear();
+
+		_NODISCARD int GetSize() const;
+		_NODISCARD bool IsEmpty() const;
+
+		_NODISCARD ConstIterator begin() const;
+		_NODISCARD ConstIterator end() const;
+		/**
+		 * \brief First keyframe on the given frame or after it.
+		 */
+		_NODISCARD ConstIterator LowerBound(int frameIndex) const;
+
+		/**
+		 * \brief All the keyframes, in frame order.
+		 */
+		_NODISCARD QList<Keyframe> GetValues() const;
+
+	private:
+		static constexpr int WordBits = 64;
+		/**
+		 * \brief Number of words of the presence bitmap in a chunk of the dense columns.
+		 */
+		static constexpr int ChunkWords = 16;
+		static constexpr int ChunkFrames = ChunkWords * WordBits;
+
+		/**
+		 * \brief The dense columns of ChunkFrames consecutive frames. Element i is the
+		 * keyframe of the frame i of the chunk, if bit i of the presence bitmap is set. The
+		 * other elements are meaningless.
+		 */
+		struct DenseChunk
+		{
+			std::array<int32_t, ChunkFrames> x;
+			std::array<int32_t, ChunkFrames> y;
+			std::array<float, ChunkFrames> confidence;
+			std::array<int32_t, ChunkFrames> seedFrame;
+			std::array<uint64_t, ChunkWords> presence;
+			/**
+			 * \brief Number of keyframes in the chunk. The chunk is freed when it drops to 0.
+			 */
+			int count;
+		};
+
+		_NODISCARD int GetDenseSize() const;
+		_NODISCARD bool IsDensePresent(int offset) const;
+		void SetDensePresent(int offset, bool present);
+		/**
+		 * \brief Offset of the first present dense keyframe at the given offset or after it,
+		 * or the size of the dense columns if there is none.
+		 */
+		_NODISCARD int FindDensePresent(int offset) const;
+		/**
+		 * \brief Offset of the last present dense keyframe at the given offset or before
+		 * it, or -1 if there is none.
+		 */
+		_NODISCARD int FindLastDensePresent(int offset) const;
+		/**
+		 * \brief Index of the first set bit at the given index or after it in a level of
+		 * the presence bitmap, or -1 if there is none.
+		 * \param level 0 for the bitmap itself, n for its nth summary.
+		 */
+		_NODISCARD int FindPresentBit(size_t level, int index) const;
+		/**
+		 * \brief Index of the last set bit at the given index or before it in a level of
+		 * the presence bitmap, or -1 if there is none.
+		 */
+		_NODISCARD int FindLastPresentBit(size_t level, int index) const;
+		/**
+		 * \brief Word of a level of the presence bitmap. The words of the missing chunks
+		 * are empty.
+		 */
+		_NODISCARD uint64_t GetPresenceWord(size_t level, int index) const;
+		_NODISCARD int GetPresenceWordCount(size_t level) const;
+		/**
+		 * \brief Fits the summaries to the size of the bitmap. The words added to or
+		 * removed from the bitmap must be empty.
+		 */
+		void ResizePresenceSummary();
+		void RebuildPresenceSummary();
+		/**
+		 * \brief Grows the dense columns so that they cover the given frame, and allocates
+		 * the chunk of the frame.
+		 */
+		void ReserveDenseFrame(int frameIndex);
+		/**
+		 * \brief Drops the empty chunks at the beginning and at the end of the dense columns,
+		 * and all of them when no dense keyframe is left.
+		 */
+		void TrimDense();
+		void ClearDense();
+		_NODISCARD static int AlignToChunk(int frameIndex);
+		_NODISCARD Keyframe GetDenseKeyframe(int offset) const;
+		/**
+		 * \brief Index of the first sparse keyframe on the given frame or after it.
+		 */
+		_NODISCARD int SparseLowerBound(int frameIndex) const;
+		void RemoveSparse(int frameIndex);
+
+		/**
+		 * \brief Frame of the first element of the dense columns. A multiple of
+		 * ChunkFrames.
+		 */
+		int m_denseFirstFrame;
+		/**
+		 * \brief Dense columns of the tracked keyframes. Chunk i holds the frames from
+		 * m_denseFirstFrame + i * ChunkFrames, and is null when none of them has a keyframe.
+		 */
+		std::vector<std::unique_ptr<DenseChunk>> m_denseChunks;
+		/**
+		 * \brief Summaries of the presence bitmap: bit i of level n is set if word i of
+		 * level n - 1 is not empty, level 0 being the bitmap of the chunks. The last level
+		 * has a single word.
+		 */
+		std::vector<std::vector<uint64_t>> m_presenceSummary;
+		int m_denseCount;
+		/**
+		 * \brief The manual keyframes, sorted by frame. A frame is never both here and in
+		 * the dense columns.
+		 */
+		std::vector<Keyframe> m_sparse;
+	};
+}
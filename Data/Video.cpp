@@ -1,7 +1,7 @@
 #include "Video.h"
 #include <QFile>
-#include <QDebug>
 #include <QDataStream>
+#include "../Logging/Log.h"
 
 namespace Data
 {
@@ -13,7 +13,12 @@ namespace Data
 		m_currentFrameIndex(0),
 		m_width(1280),
 		m_height(720),
-		m_capture()
+		m_source(),
+		m_frameCache(),
+		m_diskCache(),
+		m_prefetcher(),
+		m_proxy(),
+		m_isPreviewFrame(false)
 	{
 		m_frameMat.setTo(cv::Scalar(0.0, 0.0, 0.0));
 	}
@@ -26,7 +31,12 @@ namespace Data
 		m_currentFrameIndex(other.m_currentFrameIndex),
 		m_width(other.m_width),
 		m_height(other.m_height),
-		m_capture(other.m_capture)
+		m_source(std::move(other.m_source)),
+		m_frameCache(std::move(other.m_frameCache)),
+		m_diskCache(std::move(other.m_diskCache)),
+		m_prefetcher(std::move(other.m_prefetcher)),
+		m_proxy(std::move(other.m_proxy)),
+		m_isPreviewFrame(other.m_isPreviewFrame)
 	{
 	}
 
@@ -39,7 +49,12 @@ namespace Data
 		m_currentFrameIndex = other.m_currentFrameIndex;
 		m_width = other.m_width;
 		m_height = other.m_height;
-		m_capture = other.m_capture;
+		m_source = std::move(other.m_source);
+		m_frameCache = std::move(other.m_frameCache);
+		m_diskCache = std::move(other.m_diskCache);
+		m_prefetcher = std::move(other.m_prefetcher);
+		m_proxy = std::move(other.m_proxy);
+		m_isPreviewFrame = other.m_isPreviewFrame;
 		return *this;
 	}
 
@@ -48,49 +63,59 @@ namespace Data
 		// 1. Before changing anything, ensure the file at the specified path exists.
 		if (!QFile::exists(path))
 		{
-			qWarning() << "Video at" << path << "does not exist.";
+			qCWarning(LogVideo) << "Video at" << path << "does not exist.";
 			return false;
 		}
 
-		// 2. Try loading the video on a dummy capture to see if it works.
-		cv::VideoCapture testCapture;
-		testCapture.open(path.toStdString());
-		if (!testCapture.isOpened())
+		// 2. Try loading the video on a new frame source to see if it works.
+		std::unique_ptr<FrameSource> source = CreateFrameSource(path);
+		if (!source->Open(path))
 		{
-			qWarning() << "Could not load the video at" << path << "(but the file does exist -- make sure it is a video).";
+			qCWarning(LogVideo) << "Could not load the video at" << path << "(but the file does exist -- make sure it is a video or an image sequence).";
 			return false;
 		}
 
-		// 3. Reset all the members of the class: if loading the video fails despite the previous test,
-		// this class must hold no data related to the previous video.
+		LoadFromSource(std::move(source), path);
+		return true;
+	}
+
+	void Video::LoadFromSource(std::unique_ptr<FrameSource> source, const QString& path)
+	{
+		// 1. Reset all the members of the class: this class must hold no data related to
+		// the previous video.
 		m_filePath = QString();
 		m_currentFrameIndex = 0;
 		m_frameRate = 0;
 		m_frameCount = 0;
-		if (m_capture.isOpened())
-			m_capture.release();
-		m_frameMat.setTo(cv::Scalar(0.0, 0.0, 0.0));
+		m_frameCache.Clear();
+		if (m_prefetcher)
+			m_prefetcher->Stop();
+		if (m_proxy)
+			m_proxy->Close();
+		m_isPreviewFrame = false;
+		m_frameMat = cv::Mat(m_height, m_width, CV_8UC3, cv::Scalar(0.0, 0.0, 0.0));
+		if (m_diskCache)
+			m_diskCache->Close();
 
-		// 4. Load the video.
-		m_capture.open(path.toStdString());
-		if (m_capture.isOpened())
-		{
-			m_frameRate = static_cast<int>(m_capture.get(cv::CAP_PROP_FPS));
-			m_frameCount = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_COUNT));
-			m_width = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_WIDTH));
-			m_height = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_HEIGHT));
-		}
-		else
-		{
-			qWarning() << "Could not load the video at" << path << "(but the file does exist -- make sure it is a video).";
-			return false;
-		}
+		// 2. Load the video.
+		m_source = std::move(source);
+		m_frameRate = m_source->GetFrameRate();
+		m_frameCount = m_source->GetFrameCount();
+		m_width = m_source->GetWidth();
+		m_height = m_source->GetHeight();
 		m_filePath = path;
+
+		// The background workers use their own sources on the same video.
+		if (m_prefetcher)
+			m_prefetcher->Start(m_source->Clone(), 1);
+		if (m_proxy)
+			m_proxy->Open(m_filePath, m_source->Clone());
+		if (m_diskCache)
+			m_diskCache->Open(m_filePath, m_frameCount, m_width, m_height, CV_8UC3);
 		emit VideoLoaded();
 
-		// 5. Load the first frame of the video.
+		// 3. Load the first frame of the video.
 		ReadFrameAtIndex(0);
-		return true;
 	}
 
 	void Video::ReadNextFrame(const bool forceJump)
@@ -103,7 +128,7 @@ namespace Data
 		}
 
 		// Read the next frame and increment the counter.
-		m_capture >> m_frameMat;
+		LoadFrame(nextIndex);
 		m_currentFrameIndex++;
 
 		emit FrameChanged(m_currentFrameIndex, forceJump);
@@ -124,13 +149,149 @@ namespace Data
 		// (this is needed for instance for the first frame read.)
 		else
 		{
-			m_capture.set(cv::CAP_PROP_POS_FRAMES, clampedIndex);
-			m_capture >> m_frameMat;
+			LoadFrame(clampedIndex);
 			m_currentFrameIndex = clampedIndex;
 			emit FrameChanged(m_currentFrameIndex, true);
 		}
 	}
 
+	void Video::PreviewFrameAtIndex(const int index)
+	{
+		if (!IsLoaded())
+			return;
+		const int clampedIndex = std::clamp(index, 0, m_frameCount - 1);
+
+		// Without a proxy, or for a frame that is already in memory, the full-resolution
+		// frame is as fast to get.
+		cv::Mat frame;
+		if (!m_proxy || !m_proxy->IsReady() || GetCachedFrame(clampedIndex, frame) || !m_proxy->Read(clampedIndex, frame))
+		{
+			ReadFrameAtIndex(clampedIndex);
+			return;
+		}
+
+		m_frameMat = frame;
+		m_isPreviewFrame = true;
+		m_currentFrameIndex = clampedIndex;
+		emit FrameChanged(m_currentFrameIndex, true);
+	}
+
+	void Video::ShowFrame(const int index, const cv::Mat& frame)
+	{
+		if (!IsLoaded() || frame.empty())
+			return;
+
+		m_frameCache.Insert(index, frame);
+		m_frameMat = frame;
+		m_isPreviewFrame = false;
+		m_currentFrameIndex = std::clamp(index, 0, m_frameCount - 1);
+		emit FrameChanged(m_currentFrameIndex, true);
+	}
+
+	std::unique_ptr<FrameSource> Video::CloneSource() const
+	{
+		return m_source ? m_source->Clone() : nullptr;
+	}
+
+	void Video::SetFrameCacheBudget(const int megabytes)
+	{
+		m_frameCache.SetBudget(megabytes);
+	}
+
+	void Video::SetReadAhead(const int frameCount)
+	{
+		if (frameCount <= 0)
+		{
+			m_prefetcher.reset();
+			return;
+		}
+		if (m_prefetcher && m_prefetcher->GetCapacity() == frameCount)
+			return;
+
+		m_prefetcher = std::make_unique<FramePrefetcher>(frameCount);
+		if (IsLoaded())
+			m_prefetcher->Start(m_source->Clone(), m_currentFrameIndex + 1);
+	}
+
+	void Video::SetDiskCache(const bool enabled, const int maxSizeGigabytes)
+	{
+		if (!enabled)
+		{
+			// The current frame may point into the mapped file.
+			if (m_diskCache && !m_frameMat.empty())
+				m_frameMat = m_frameMat.clone();
+			m_diskCache.reset();
+			return;
+		}
+		if (m_diskCache)
+		{
+			m_diskCache->SetMaxSize(maxSizeGigabytes);
+			return;
+		}
+
+		m_diskCache = std::make_unique<DiskFrameCache>();
+		m_diskCache->SetMaxSize(maxSizeGigabytes);
+		if (IsLoaded())
+			m_diskCache->Open(m_filePath, m_frameCount, m_width, m_height, CV_8UC3);
+	}
+
+	void Video::SetProxyEnabled(const bool enabled)
+	{
+		if (!enabled)
+		{
+			m_proxy.reset();
+			m_isPreviewFrame = false;
+			return;
+		}
+		if (m_proxy)
+			return;
+
+		m_proxy = std::make_unique<ProxyVideo>();
+		if (IsLoaded())
+			m_proxy->Open(m_filePath, m_source->Clone());
+	}
+
+	void Video::LoadFrame(const int index)
+	{
+		m_isPreviewFrame = false;
+
+		// 1. Frame visited recently or in a previous session: no seek and no decode.
+		if (GetCachedFrame(index, m_frameMat))
+			return;
+
+		// 2. Frame already decoded by the read-ahead thread. On a miss, the prefetcher
+		// restarts after this frame, and the frame is decoded synchronously below.
+		cv::Mat prefetchedFrame;
+		if (m_prefetcher && m_prefetcher->Pop(index, prefetchedFrame))
+		{
+			CacheFrame(index, prefetchedFrame);
+			m_frameMat = prefetchedFrame;
+			return;
+		}
+
+		// 3. Read the frame from the source. Consecutive frames are read without seeking.
+		cv::Mat frame;
+		if (m_source && m_source->Read(index, frame))
+		{
+			CacheFrame(index, frame);
+		}
+		m_frameMat = frame;
+	}
+
+	bool Video::GetCachedFrame(const int index, cv::Mat& frame)
+	{
+		// Frames found on the disk are not put in the memory cache: they are served from
+		// the mapped file without any copy, so keeping them in memory would gain nothing.
+		return m_frameCache.Get(index, frame) || (m_diskCache && m_diskCache->Get(index, frame));
+	}
+
+	void Video::CacheFrame(const int index, const cv::Mat& frame)
+	{
+		m_frameCache.Insert(index, frame);
+		if (m_diskCache)
+			m_diskCache->Insert(index, frame);
+	}
+
 	const cv::Mat& Video::GetCurrentImage() const
 	{
 		return m_frameMat;
@@ -170,4 +331,9 @@ namespace Data
 	{
 		return m_filePath;
 	}
+
+	bool Video::IsPreviewFrame() const
+	{
+		return m_isPreviewFrame;
+	}
 }
@@ -1,7 +1,13 @@
 #pragma once
 
 #include "../common.h"
+#include <memory>
 #include <opencv2/opencv.hpp>
+#include "DiskFrameCache.h"
+#include "FrameCache.h"
+#include "FramePrefetcher.h"
+#include "FrameSource.h"
+#include "ProxyVideo.h"
 #include <QObject>
 
 namespace Data
@@ -25,19 +31,79 @@ namespace Data
 		_NODISCARD int GetFrameCount() const;
 		_NODISCARD bool IsLoaded() const;
 		_NODISCARD QString GetFilePath() const;
+		/**
+		 * \brief Whether the current image comes from the low-resolution proxy. In this
+		 * case, it is smaller than the video by a factor of ProxyVideo::DownscaleFactor.
+		 */
+		_NODISCARD bool IsPreviewFrame() const;
 
 		/**
-		 * \brief Tries loading the video at the specified path.
+		 * \brief Tries loading the video at the specified path. The path can also be any
+		 * image of a numbered image sequence, in which case the whole sequence is loaded.
 		 * \param path Path to the video file on the disk.
 		 * \return Whether loading the video was a success or not.
 		 */
 		bool LoadFromFile(const QString& path);
+		/**
+		 * \brief Uses an already opened frame source as the video, for media that do not
+		 * come from a file (generated frames for instance).
+		 * \param path Path reported by GetFilePath. Clones of the source are used by the
+		 * background workers: they must not need it.
+		 */
+		void LoadFromSource(std::unique_ptr<FrameSource> source, const QString& path);
 
 		/**
 		 * \brief Reads the video at a specified frame.
 		 * \param index Index of the video frame to read.
 		 */
 		void ReadFrameAtIndex(const int& index);
+		/**
+		 * \brief Reads a low-resolution version of the frame at the given index, for fast
+		 * display while scrubbing. Falls back to ReadFrameAtIndex when no proxy is ready.
+		 * Reading the same index with ReadFrameAtIndex afterwards swaps in the
+		 * full-resolution frame.
+		 * \param index Index of the video frame to read.
+		 */
+		void PreviewFrameAtIndex(int index);
+		/**
+		 * \brief Displays a frame decoded by another source on the same video (by a
+		 * background worker for instance), as if it had been read with ReadFrameAtIndex.
+		 * \param index Index of the frame in the video.
+		 * \param frame Full-resolution content of the frame.
+		 */
+		void ShowFrame(int index, const cv::Mat& frame);
+		/**
+		 * \brief Opens a new frame source on the loaded video, for use by another thread.
+		 * \return The source, or null if no video is loaded.
+		 */
+		_NODISCARD std::unique_ptr<FrameSource> CloneSource() const;
+
+		/**
+		 * \brief Sets the maximum amount of memory used to keep recently decoded frames.
+		 * \param megabytes Budget in megabytes. 0 disables the cache.
+		 */
+		void SetFrameCacheBudget(int megabytes);
+		/**
+		 * \brief Enables or disables the read-ahead mode. In this mode, a background thread
+		 * decodes the frames located after the playhead, so that reading the next frame
+		 * usually does not require any decoding on the calling thread.
+		 * \param frameCount Number of frames decoded in advance. 0 disables the read-ahead.
+		 */
+		void SetReadAhead(int frameCount);
+		/**
+		 * \brief Enables or disables the persistent frame cache. When enabled, decoded frames
+		 * are also stored on the disk, and reused by later sessions on the same video.
+		 * \param enabled Whether to use the persistent cache.
+		 * \param maxSizeGigabytes Maximum size of the cache files of all the videos together.
+		 * The least recently used videos are evicted first.
+		 */
+		void SetDiskCache(bool enabled, int maxSizeGigabytes);
+		/**
+		 * \brief Enables or disables the low-resolution proxy used for previews. When
+		 * enabled, the proxy of each loaded video is generated in the background if it
+		 * does not exist yet.
+		 */
+		void SetProxyEnabled(bool enabled);
 
 	public slots:
 
@@ -60,6 +126,20 @@ namespace Data
 		void VideoLoaded();
 
 	private:
+		/**
+		 * \brief Puts the frame at the given index in m_frameMat, either from the frame
+		 * caches, from the read-ahead buffer or by reading it from the frame source.
+		 */
+		void LoadFrame(int index);
+		/**
+		 * \brief Tries getting a frame from the memory cache, then from the disk cache.
+		 */
+		_NODISCARD bool GetCachedFrame(int index, cv::Mat& frame);
+		/**
+		 * \brief Stores a freshly decoded frame in the memory and disk caches.
+		 */
+		void CacheFrame(int index, const cv::Mat& frame);
+
 		/**
 		 * \brief Path of the video file on the disk.
 		 */
@@ -89,8 +169,32 @@ namespace Data
 		 */
 		int m_height;
 		/**
-		 * \brief OpenCV object used to load the frames from the video file into memory.
+		 * \brief Object used to load the frames from the disk into memory (video file or
+		 * image sequence). Null when no video is loaded.
+		 */
+		std::unique_ptr<FrameSource> m_source;
+		/**
+		 * \brief Recently decoded frames, so that going back to them does not require
+		 * seeking and decoding again.
+		 */
+		FrameCache m_frameCache;
+		/**
+		 * \brief Persistent frame cache. Null when it is disabled.
+		 */
+		std::unique_ptr<DiskFrameCache> m_diskCache;
+		/**
+		 * \brief Background decoder used in read-ahead mode. Null when the read-ahead is
+		 * disabled.
+		 */
+		std::unique_ptr<FramePrefetcher> m_prefetcher;
+		/**
+		 * \brief Low-resolution copy of the video used for previews. Null when the proxy
+		 * is disabled.
+		 */
+		std::unique_ptr<ProxyVideo> m_proxy;
+		/**
+		 * \brief Whether m_frameMat comes from the proxy.
 		 */
-		cv::VideoCapture m_capture;
+		bool m_isPreviewFrame;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "VideoCaptureSource.h"
+#include "FramePool.h"
+#include "../Profiling/Profiler.h"
+
+namespace Data
+{
+	VideoCaptureSource::VideoCaptureSource() :
+		m_path(),
+		m_capture(),
+		m_capturePosition(0),
+		m_gopIndex(),
+		m_frameCount(0),
+		m_frameRate(0),
+		m_width(0),
+		m_height(0)
+	{
+	}
+
+	bool VideoCaptureSource::Open(const QString& path)
+	{
+		std::shared_ptr<GopIndex> gopIndex = std::make_shared<GopIndex>();
+		if (!OpenCapture(path, gopIndex))
+			return false;
+
+		// Only index videos that can actually be read. Building the index reads the whole
+		// file: it runs in the background, and the seeks use the backend until it is done.
+		gopIndex->LoadOrBuild(path);
+		return true;
+	}
+
+	std::unique_ptr<FrameSource> VideoCaptureSource::Clone() const
+	{
+		std::unique_ptr<VideoCaptureSource> clone = std::make_unique<VideoCaptureSource>();
+		if (!clone->OpenCapture(m_path, m_gopIndex))
+			return nullptr;
+		return clone;
+	}
+
+	bool VideoCaptureSource::Read(const int frameIndex, cv::Mat& frame)
+	{
+		// 1. Move the capture on the requested frame. This does nothing when reading
+		// consecutive frames, and uses the I-frames index otherwise.
+		if (m_capturePosition != frameIndex)
+		{
+			const Profiling::ScopedTimer timer("Video seek");
+			m_capturePosition = m_gopIndex->Seek(m_capture, m_capturePosition, frameIndex);
+		}
+
+		// 2. Decode into a recycled buffer.
+		const Profiling::ScopedTimer timer("Video decode");
+		frame = FramePool::GetInstance().Allocate(m_height, m_width, CV_8UC3);
+		if (!m_capture.read(frame))
+			return false;
+		m_capturePosition++;
+		return true;
+	}
+
+	int VideoCaptureSource::GetFrameCount() const
+	{
+		return m_frameCount;
+	}
+
+	int VideoCaptureSource::GetFrameRate() const
+	{
+		return m_frameRate;
+	}
+
+	int VideoCaptureSource::GetWidth() const
+	{
+		return m_width;
+	}
+
+	int VideoCaptureSource::GetHeight() const
+	{
+		return m_height;
+	}
+
+	bool VideoCaptureSource::OpenCapture(const QString& path, std::shared_ptr<const GopIndex> gopIndex)
+	{
+		if (!m_capture.open(path.toStdString()))
+			return false;
+
+		m_path = path;
+		m_capturePosition = 0;
+		m_gopIndex = std::move(gopIndex);
+		m_frameRate = static_cast<int>(m_capture.get(cv::CAP_PROP_FPS));
+		m_frameCount = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_COUNT));
+		m_width = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_WIDTH));
+		m_height = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+		return true;
+	}
+}
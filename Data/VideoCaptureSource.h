@@ -0,0 +1,53 @@
+#pragma once
+
+#include "FrameSource.h"
+#include <opencv2/videoio.hpp>
+#include "GopIndex.h"
+
+namespace Data
+{
+	/**
+	 * \brief Frame source reading a video file with cv::VideoCapture. Random access goes
+	 * through the I-frames index of the video.
+	 */
+	class VideoCaptureSource final : public FrameSource
+	{
+	public:
+		VideoCaptureSource();
+		~VideoCaptureSource() override = default;
+
+		bool Open(const QString& path) override;
+		_NODISCARD std::unique_ptr<FrameSource> Clone() const override;
+		bool Read(int frameIndex, cv::Mat& frame) override;
+
+		_NODISCARD int GetFrameCount() const override;
+		_NODISCARD int GetFrameRate() const override;
+		_NODISCARD int GetWidth() const override;
+		_NODISCARD int GetHeight() const override;
+
+	private:
+		/**
+		 * \brief Opens the capture, reusing an existing I-frames index.
+		 */
+		bool OpenCapture(const QString& path, std::shared_ptr<const GopIndex> gopIndex);
+
+		QString m_path;
+		/**
+		 * \brief OpenCV object used to load the frames from the video file into memory.
+		 */
+		cv::VideoCapture m_capture;
+		/**
+		 * \brief Index of the frame the capture will return on its next read.
+		 */
+		int m_capturePosition;
+		/**
+		 * \brief I-frames of the video, used to seek to exact frames once it is ready.
+		 * Shared with the clones of this source: it is never modified once ready.
+		 */
+		std::shared_ptr<const GopIndex> m_gopIndex;
+		int m_frameCount;
+		int m_frameRate;
+		int m_width;
+		int m_height;
+	};
+}
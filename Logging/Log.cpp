@@ -0,0 +1,132 @@
+#include "Log.h"
+#include <QDateTime>
+
+Q_LOGGING_CATEGORY(LogData, "referencetracker.data")
+Q_LOGGING_CATEGORY(LogVideo, "referencetracker.video")
+Q_LOGGING_CATEGORY(LogTracking, "referencetracker.tracking")
+Q_LOGGING_CATEGORY(LogUi, "referencetracker.ui")
+
+namespace Logging
+{
+	AsyncLogSink* AsyncLogSink::s_instance = nullptr;
+
+	AsyncLogSink::AsyncLogSink(FILE* output) :
+		m_output(output),
+		m_previousHandler(nullptr),
+		m_mutex(),
+		m_condition(),
+		m_ring(Capacity),
+		m_head(0),
+		m_count(0),
+		m_droppedCount(0),
+		m_stopRequested(false),
+		m_thread()
+	{
+		m_thread = std::thread(&AsyncLogSink::Run, this);
+		s_instance = this;
+		m_previousHandler = qInstallMessageHandler(&AsyncLogSink::HandleMessage);
+	}
+
+	AsyncLogSink::~AsyncLogSink()
+	{
+		qInstallMessageHandler(m_previousHandler);
+		s_instance = nullptr;
+		{
+			std::lock_guard lock(m_mutex);
+			m_stopRequested = true;
+		}
+		m_condition.notify_one();
+		m_thread.join();
+	}
+
+	void AsyncLogSink::HandleMessage(const QtMsgType type, const QMessageLogContext& context, const QString& text)
+	{
+		AsyncLogSink* sink = s_instance;
+		if (!sink)
+			return;
+
+		Message message{ type, context.category ? context.category : "default", text, std::chrono::system_clock::now() };
+		if (type != QtFatalMsg)
+		{
+			sink->Push(std::move(message));
+			return;
+		}
+
+		// The process is about to abort: write everything now.
+		{
+			std::unique_lock lock(sink->m_mutex);
+			sink->Drain(lock);
+		}
+		sink->Write(message);
+		fflush(sink->m_output);
+		abort();
+	}
+
+	void AsyncLogSink::Push(Message&& message)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_count == m_ring.size())
+			{
+				m_droppedCount++;
+				return;
+			}
+			m_ring[(m_head + m_count) % m_ring.size()] = std::move(message);
+			m_count++;
+		}
+		m_condition.notify_one();
+	}
+
+	void AsyncLogSink::Run()
+	{
+		std::unique_lock lock(m_mutex);
+		while (true)
+		{
+			m_condition.wait(lock, [this] { return m_count > 0 || m_stopRequested; });
+			Drain(lock);
+			if (m_stopRequested && m_count == 0)
+				break;
+		}
+	}
+
+	void AsyncLogSink::Drain(std::unique_lock<std::mutex>& lock)
+	{
+		// Take the pending messages out of the ring, so that the loggers are not blocked
+		// while they are written.
+		std::vector<Message> messages;
+		messages.reserve(m_count);
+		for (; m_count > 0; m_count--)
+		{
+			messages.push_back(std::move(m_ring[m_head]));
+			m_head = (m_head + 1) % m_ring.size();
+		}
+		const int64_t droppedCount = m_droppedCount;
+		m_droppedCount = 0;
+
+		lock.unlock();
+		if (droppedCount > 0)
+			fprintf(m_output, "%lld log messages were dropped.\n", static_cast<long long>(droppedCount));
+		for (const Message& message : messages)
+		{
+			Write(message);
+		}
+		fflush(m_output);
+		lock.lock();
+	}
+
+	void AsyncLogSink::Write(const Message& message) const
+	{
+		const char* level = "D";
+		switch (message.type)
+		{
+		case QtDebugMsg: level = "D"; break;
+		case QtInfoMsg: level = "I"; break;
+		case QtWarningMsg: level = "W"; break;
+		case QtCriticalMsg: level = "C"; break;
+		case QtFatalMsg: level = "F"; break;
+		}
+		const qint64 milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(message.time.time_since_epoch()).count();
+		const QString time = QDateTime::fromMSecsSinceEpoch(milliseconds).toString("hh:mm:ss.zzz");
+		fprintf(m_output, "%s %s %s: %s\n", qPrintable(time), level, message.category, qPrintable(message.text));
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../common.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <QLoggingCategory>
+#include <QString>
+
+/**
+ * Categories of the messages, to log through qCDebug, qCInfo, qCWarning and qCCritical.
+ * These macros only format a message when its category is enabled for its level, and
+ * qCDebug compiles to nothing outside of debug builds (QT_NO_DEBUG_OUTPUT, see
+ * CMakeLists.txt). Categories are toggled at runtime with QLoggingCategory filter rules,
+ * for instance "referencetracker.tracking.debug=false".
+ */
+Q_DECLARE_LOGGING_CATEGORY(LogData)
+Q_DECLARE_LOGGING_CATEGORY(LogVideo)
+Q_DECLARE_LOGGING_CATEGORY(LogTracking)
+Q_DECLARE_LOGGING_CATEGORY(LogUi)
+
+namespace Logging
+{
+	/**
+	 * \brief Qt message handler writing the messages from a background thread, so that the
+	 * threads logging only pay for formatting their message and moving it into a ring
+	 * buffer, never for the console or file I/O.
+	 * When the ring is full, the new messages are dropped and counted; the sink reports how
+	 * many were lost. Fatal messages are written synchronously, after the pending ones.
+	 * There is at most one sink at a time: it is installed by the constructor, and flushed
+	 * and uninstalled by the destructor.
+	 */
+	class AsyncLogSink
+	{
+	public:
+		/**
+		 * \brief Number of messages the ring holds before dropping new ones.
+		 */
+		static constexpr size_t Capacity = 4096;
+
+		/**
+		 * \param output Stream the messages are written to.
+		 */
+		explicit AsyncLogSink(FILE* output = stderr);
+		~AsyncLogSink();
+		Q_DISABLE_COPY(AsyncLogSink);
+
+	private:
+		struct Message
+		{
+			QtMsgType type{ QtDebugMsg };
+			/**
+			 * \brief Name of the category. Categories are static: only the pointer is kept.
+			 */
+			const char* category{ nullptr };
+			QString text;
+			std::chrono::system_clock::time_point time;
+		};
+
+		static void HandleMessage(QtMsgType type, const QMessageLogContext& context, const QString& text);
+		void Push(Message&& message);
+		/**
+		 * \brief Body of the sink thread.
+		 */
+		void Run();
+		/**
+		 * \brief Writes the pending messages. Called with the mutex locked, which it
+		 * releases while writing.
+		 */
+		void Drain(std::unique_lock<std::mutex>& lock);
+		void Write(const Message& message) const;
+
+		/**
+		 * \brief The installed sink, or null.
+		 */
+		static AsyncLogSink* s_instance;
+
+		FILE* m_output;
+		QtMessageHandler m_previousHandler;
+		/**
+		 * \brief Guards all the members below.
+		 */
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		/**
+		 * \brief Ring of the pending messages: m_count messages from m_head.
+		 */
+		std::vector<Message> m_ring;
+		size_t m_head;
+		size_t m_count;
+		int64_t m_droppedCount;
+		bool m_stopRequested;
+		std::thread m_thread;
+	};
+}
@@ -0,0 +1,150 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <QFile>
+#include <QTextStream>
+
+namespace Profiling
+{
+	Profiler& Profiler::GetInstance()
+	{
+		static Profiler instance;
+		return instance;
+	}
+
+	Profiler::Profiler() :
+		m_epoch(Clock::now()),
+		m_enabled(false),
+		m_droppedEventCount(0),
+		m_mutex(),
+		m_threadBuffers(),
+		m_nextThreadId(0),
+		m_sections(),
+		m_traceEvents()
+	{
+	}
+
+	void Profiler::SetEnabled(const bool enabled)
+	{
+		m_enabled = enabled;
+	}
+
+	bool Profiler::IsEnabled() const
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	void Profiler::Record(const char* name, const Clock::time_point start, const Clock::time_point end)
+	{
+		TimedEvent event{ name, std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_epoch).count(), std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() };
+		if (!GetThreadBuffer().events.TryPush(std::move(event)))
+			m_droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void Profiler::Collect()
+	{
+		std::lock_guard lock(m_mutex);
+		for (auto it = m_threadBuffers.begin(); it != m_threadBuffers.end();)
+		{
+			ThreadBuffer& buffer = **it;
+			TimedEvent event;
+			while (buffer.events.TryPop(event))
+			{
+				// 1. Rolling statistics.
+				Section& section = m_sections[event.name];
+				if (section.durations.size() < RollingWindowSize)
+					section.durations.push_back(event.duration);
+				else
+					section.durations[section.next] = event.duration;
+				section.next = (section.next + 1) % RollingWindowSize;
+				section.callCount++;
+
+				// 2. Trace history.
+				m_traceEvents.push_back({ event, buffer.threadId });
+				if (m_traceEvents.size() > MaxTraceEvents)
+					m_traceEvents.pop_front();
+			}
+
+			// 3. Forget the threads that ended, once their last events are collected.
+			if (it->use_count() == 1 && buffer.events.GetSize() == 0)
+				it = m_threadBuffers.erase(it);
+			else
+				++it;
+		}
+	}
+
+	QVector<SectionStatistics> Profiler::GetStatistics() const
+	{
+		std::lock_guard lock(m_mutex);
+		QVector<SectionStatistics> statistics;
+		std::vector<int64_t> durations;
+		for (const auto& [name, section] : m_sections)
+		{
+			durations = section.durations;
+			const auto percentile = [&durations](const double fraction)
+			{
+				const auto nth = durations.begin() + static_cast<ptrdiff_t>(fraction * (durations.size() - 1));
+				std::nth_element(durations.begin(), nth, durations.end());
+				return *nth / 1e6;
+			};
+			SectionStatistics sectionStatistics;
+			sectionStatistics.name = QString::fromStdString(name);
+			sectionStatistics.callCount = section.callCount;
+			sectionStatistics.medianMilliseconds = percentile(0.5);
+			sectionStatistics.p99Milliseconds = percentile(0.99);
+			sectionStatistics.maxMilliseconds = *std::max_element(durations.begin(), durations.end()) / 1e6;
+			statistics.push_back(sectionStatistics);
+		}
+		return statistics;
+	}
+
+	int64_t Profiler::GetDroppedEventCount() const
+	{
+		return m_droppedEventCount.load(std::memory_order_relaxed);
+	}
+
+	void Profiler::Clear()
+	{
+		Collect();
+		std::lock_guard lock(m_mutex);
+		m_sections.clear();
+		m_traceEvents.clear();
+		m_droppedEventCount = 0;
+	}
+
+	bool Profiler::ExportChromeTrace(const QString& path)
+	{
+		Collect();
+		QFile file(path);
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+			return false;
+
+		// Complete events ("ph": "X"), with times in microseconds. Written by hand rather
+		// than through QJsonDocument: a trace easily holds a million events.
+		std::lock_guard lock(m_mutex);
+		QTextStream out(&file);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		for (const TraceEvent& traceEvent : m_traceEvents)
+		{
+			out << (first ? "\n" : ",\n")
+				<< "{\"name\":\"" << traceEvent.event.name << "\",\"cat\":\"ReferenceTracker\",\"ph\":\"X\",\"pid\":1,\"tid\":" << traceEvent.threadId
+				<< ",\"ts\":" << QString::number(traceEvent.event.start / 1e3, 'f', 3)
+				<< ",\"dur\":" << QString::number(traceEvent.event.duration / 1e3, 'f', 3) << '}';
+			first = false;
+		}
+		out << "\n]}\n";
+		return out.status() == QTextStream::Ok;
+	}
+
+	Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+	{
+		thread_local std::shared_ptr<ThreadBuffer> buffer;
+		if (!buffer)
+		{
+			std::lock_guard lock(m_mutex);
+			buffer = std::make_shared<ThreadBuffer>(m_nextThreadId++);
+			m_threadBuffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+}
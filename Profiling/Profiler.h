@@ -0,0 +1,212 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <QString>
+#include <QVector>
+#include "../Tracking/SpscQueue.h"
+
+namespace Profiling
+{
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * \brief A timed section of code, as recorded by the thread that ran it.
+	 */
+	struct TimedEvent
+	{
+		/**
+		 * \brief Name of the section. Always a string literal: only the pointer is copied.
+		 */
+		const char* name{ nullptr };
+		/**
+		 * \brief Start of the section, in nanoseconds since the creation of the profiler.
+		 */
+		int64_t start{ 0 };
+		int64_t duration{ 0 };
+	};
+
+	/**
+	 * \brief Durations of a section over its last Profiler::RollingWindowSize runs.
+	 */
+	struct SectionStatistics
+	{
+		QString name;
+		/**
+		 * \brief Number of runs since the statistics were cleared.
+		 */
+		int64_t callCount{ 0 };
+		double medianMilliseconds{ 0.0 };
+		double p99Milliseconds{ 0.0 };
+		double maxMilliseconds{ 0.0 };
+	};
+
+	/**
+	 * \brief Collects the durations of the sections timed by ScopedTimer, to find out where
+	 * a slow session spends its time.
+	 * Recording is lock-free: each thread pushes its events into a queue of its own, which
+	 * only Collect empties. When a queue is full because nobody collects, the new events
+	 * are dropped instead of slowing the thread down.
+	 * The collected events feed rolling statistics per section, and a bounded history that
+	 * can be exported as a Chrome trace (chrome://tracing, Perfetto).
+	 */
+	class Profiler
+	{
+	public:
+		/**
+		 * \brief Number of events a thread can record between two Collect calls.
+		 */
+		static constexpr size_t ThreadBufferCapacity = 16384;
+		/**
+		 * \brief Number of runs of each section the percentiles are computed on.
+		 */
+		static constexpr size_t RollingWindowSize = 512;
+		/**
+		 * \brief Number of events kept for the trace export. The oldest are dropped first.
+		 */
+		static constexpr size_t MaxTraceEvents = 1000000;
+
+		_NODISCARD static Profiler& GetInstance();
+
+		/**
+		 * \brief Disabled by default, so that the command-line tools do not pay for
+		 * events nobody collects.
+		 */
+		void SetEnabled(bool enabled);
+		_NODISCARD bool IsEnabled() const;
+
+		/**
+		 * \brief Records a section run by the calling thread.
+		 */
+		void Record(const char* name, Clock::time_point start, Clock::time_point end);
+
+		/**
+		 * \brief Moves the events recorded by all the threads into the statistics and the
+		 * trace history. Called periodically by whoever displays them.
+		 */
+		void Collect();
+		/**
+		 * \brief Statistics of each section seen since the last Clear, sorted by name.
+		 */
+		_NODISCARD QVector<SectionStatistics> GetStatistics() const;
+		/**
+		 * \brief Number of events lost because a thread recorded them faster than they
+		 * were collected.
+		 */
+		_NODISCARD int64_t GetDroppedEventCount() const;
+		/**
+		 * \brief Forgets the statistics and the trace history.
+		 */
+		void Clear();
+
+		/**
+		 * \brief Collects, then writes the trace history in the Chrome trace event format.
+		 * \return Whether the file could be written.
+		 */
+		bool ExportChromeTrace(const QString& path);
+
+	private:
+		/**
+		 * \brief Events of one thread. Shared by the thread and the profiler, so that the
+		 * events of a thread that ended can still be collected.
+		 */
+		struct ThreadBuffer
+		{
+			explicit ThreadBuffer(const int threadId) :
+				events(ThreadBufferCapacity),
+				threadId(threadId)
+			{
+			}
+
+			Tracking::SpscQueue<TimedEvent> events;
+			int threadId;
+		};
+
+		struct TraceEvent
+		{
+			TimedEvent event;
+			int threadId;
+		};
+
+		/**
+		 * \brief Last durations of a section, in a ring.
+		 */
+		struct Section
+		{
+			std::vector<int64_t> durations;
+			size_t next{ 0 };
+			int64_t callCount{ 0 };
+		};
+
+		Profiler();
+		~Profiler() = default;
+		Q_DISABLE_COPY(Profiler);
+
+		/**
+		 * \brief Buffer of the calling thread, registered on the first call of each thread.
+		 */
+		_NODISCARD ThreadBuffer& GetThreadBuffer();
+
+		const Clock::time_point m_epoch;
+		std::atomic_bool m_enabled;
+		std::atomic<int64_t> m_droppedEventCount;
+
+		/**
+		 * \brief Guards all the members below. Never taken by Record, except for the first
+		 * event of each thread.
+		 */
+		mutable std::mutex m_mutex;
+		std::vector<std::shared_ptr<ThreadBuffer>> m_threadBuffers;
+		int m_nextThreadId;
+		/**
+		 * \brief Key: section name. Not the pointer: the same literal may have several
+		 * addresses.
+		 */
+		std::map<std::string, Section> m_sections;
+		std::deque<TraceEvent> m_traceEvents;
+	};
+
+	/**
+	 * \brief Times the scope it lives in, under the given name:
+	 *
+	 *     const Profiling::ScopedTimer timer("Video decode");
+	 *
+	 * Costs two clock reads and a queue push when the profiler is enabled, a branch
+	 * otherwise.
+	 */
+	class ScopedTimer
+	{
+	public:
+		/**
+		 * \param name String literal, copied as a pointer.
+		 */
+		explicit ScopedTimer(const char* name) :
+			m_name(Profiler::GetInstance().IsEnabled() ? name : nullptr),
+			m_start(m_name ? Clock::now() : Clock::time_point())
+		{
+		}
+
+		~ScopedTimer()
+		{
+			if (m_name)
+				Profiler::GetInstance().Record(m_name, m_start, Clock::now());
+		}
+
+		Q_DISABLE_COPY(ScopedTimer);
+
+	private:
+		/**
+		 * \brief Null when the profiler was disabled at construction.
+		 */
+		const char* m_name;
+		Clock::time_point m_start;
+	};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../common.h"
+#include <vector>
+#include <opencv2/core.hpp>
+#include <QPoint>
+#include <QVector>
+#include "TrackingPipeline.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief Tracker processing all the points of a frame at once, instead of one
+	 * cv::Tracker per point, so that the work done per frame is shared by all the points.
+	 */
+	class BatchedTracker
+	{
+	public:
+		virtual ~BatchedTracker() = default;
+
+		/**
+		 * \brief Starts tracking the given points from the given image.
+		 */
+		virtual void Initialize(const cv::Mat& image, const QVector<QPoint>& positions) = 0;
+		/**
+		 * \brief Tracks all the points on the next frame.
+		 * \param succeeded Return param: for each point, whether it was found. The position
+		 * of a lost point is not updated.
+		 */
+		virtual void Update(const FrameBundle& frame, std::vector<char>& succeeded) = 0;
+		/**
+		 * \brief Current position of each point.
+		 */
+		_NODISCARD virtual QPoint GetPosition(int pointIndex) const = 0;
+		/**
+		 * \brief Confidence in the last position of each point, between 0 and 1.
+		 */
+		_NODISCARD virtual float GetConfidence(int pointIndex) const = 0;
+		/**
+		 * \brief Data the tracker needs the pipeline to compute for each frame.
+		 */
+		_NODISCARD virtual Preprocessing GetPreprocessing() const = 0;
+	};
+}
@@ -0,0 +1,61 @@
+#include "CameraMotionEstimator.h"
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+namespace
+{
+	float Median(std::vector<float>& values)
+	{
+		const auto middle = values.begin() + static_cast<ptrdiff_t>(values.size() / 2);
+		std::nth_element(values.begin(), middle, values.end());
+		return *middle;
+	}
+}
+
+namespace Tracking
+{
+	CameraMotionEstimator::CameraMotionEstimator() :
+		m_previousFrame(),
+		m_previousFeatures()
+	{
+	}
+
+	cv::Point2f CameraMotionEstimator::Estimate(const cv::Mat& gray)
+	{
+		// 1. Work at a reduced resolution.
+		const double scale = gray.cols > AnalysisWidth ? static_cast<double>(AnalysisWidth) / gray.cols : 1.0;
+		cv::Mat frame;
+		if (scale < 1.0)
+			cv::resize(gray, frame, cv::Size(), scale, scale, cv::INTER_AREA);
+		else
+			frame = gray;
+
+		// 2. Follow the features of the previous frame, and keep the median displacement.
+		cv::Point2f motion;
+		if (!m_previousFrame.empty() && static_cast<int>(m_previousFeatures.size()) >= MinFeatures)
+		{
+			std::vector<cv::Point2f> features;
+			std::vector<uchar> status;
+			std::vector<float> errors;
+			cv::calcOpticalFlowPyrLK(m_previousFrame, frame, m_previousFeatures, features, status, errors);
+			std::vector<float> dx;
+			std::vector<float> dy;
+			for (size_t i = 0; i < features.size(); i++)
+			{
+				if (!status[i])
+					continue;
+				dx.push_back(features[i].x - m_previousFeatures[i].x);
+				dy.push_back(features[i].y - m_previousFeatures[i].y);
+			}
+			if (static_cast<int>(dx.size()) >= MinFeatures)
+				motion = cv::Point2f(Median(dx), Median(dy)) / static_cast<float>(scale);
+		}
+
+		// 3. Detect new features for the next frame. Detecting them again each time keeps
+		// them spread over what is currently visible.
+		cv::goodFeaturesToTrack(frame, m_previousFeatures, MaxFeatures, 0.01, 8.0);
+		m_previousFrame = frame.clone();
+		return motion;
+	}
+}
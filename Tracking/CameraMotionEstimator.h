@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../common.h"
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace Tracking
+{
+	/**
+	 * \brief Estimates the global translation of the image between consecutive frames, from
+	 * sparse features followed with pyramidal Lucas-Kanade optical flow. The estimate is
+	 * the median of the feature displacements, so the tracked objects themselves, as long as
+	 * they do not cover most of the frame, do not bias it.
+	 * The frames are analysed at a reduced width: a pixel of precision is plenty to centre
+	 * a search window.
+	 */
+	class CameraMotionEstimator
+	{
+	public:
+		/**
+		 * \brief The frames are downscaled to at most this width before the analysis.
+		 */
+		static constexpr int AnalysisWidth = 640;
+		static constexpr int MaxFeatures = 300;
+		/**
+		 * \brief Below this many followed features, the motion is considered unknown.
+		 */
+		static constexpr int MinFeatures = 12;
+
+		CameraMotionEstimator();
+
+		/**
+		 * \brief Motion from the frame of the previous call to the given one.
+		 * \param gray Grayscale frame.
+		 * \return The translation in full-resolution pixels, or (0, 0) on the first call
+		 * and when there are too few features to follow.
+		 */
+		_NODISCARD cv::Point2f Estimate(const cv::Mat& gray);
+
+	private:
+		cv::Mat m_previousFrame;
+		std::vector<cv::Point2f> m_previousFeatures;
+	};
+}
@@ -0,0 +1,120 @@
+#include "CascadeTracker.h"
+#include <algorithm>
+
+namespace Tracking
+{
+	cv::Ptr<CascadeTracker> CascadeTracker::Create(const cv::Ptr<cv::Tracker>& cheapTracker, const cv::Ptr<cv::Tracker>& expensiveTracker)
+	{
+		return cv::Ptr<CascadeTracker>(new CascadeTracker(cheapTracker, expensiveTracker));
+	}
+
+	CascadeTracker::CascadeTracker(const cv::Ptr<cv::Tracker>& cheapTracker, const cv::Ptr<cv::Tracker>& expensiveTracker) :
+		m_cheapTracker(cheapTracker),
+		m_expensiveTracker(expensiveTracker),
+		m_verifier(NccTracker::Create()),
+		m_escalated(false),
+		m_stableFrames(0),
+		m_escalatedFrameCount(0),
+		m_previousArea(),
+		m_previousAreaRect(),
+		m_previousImageSize(),
+		m_previousImageType(0),
+		m_boundingBox(),
+		m_score(0.0f)
+	{
+	}
+
+	void CascadeTracker::init(cv::InputArray image, const cv::Rect& boundingBox)
+	{
+		const cv::Mat frame = image.getMat();
+		m_cheapTracker->init(frame, boundingBox);
+		m_verifier->init(frame, boundingBox);
+		m_escalated = false;
+		m_stableFrames = 0;
+		m_escalatedFrameCount = 0;
+		KeepPreviousArea(frame, boundingBox);
+		m_boundingBox = boundingBox;
+		m_score = 1.0f;
+	}
+
+	bool CascadeTracker::update(cv::InputArray image, cv::Rect& boundingBox)
+	{
+		const cv::Mat frame = image.getMat();
+		cv::Rect box = m_boundingBox;
+
+		// 1. Try the cheap tracker first, unless it already gave up on the previous frames.
+		if (!m_escalated)
+		{
+			const bool found = m_cheapTracker->update(frame, box);
+			m_score = found ? MeasureConfidence(frame, box) : 0.0f;
+			if (m_score < EscalationScore)
+			{
+				// Restart the expensive tracker from the last position the cheap one was sure
+				// of: it only sees the frames it tracks.
+				m_expensiveTracker->init(GetPreviousImage(), m_boundingBox);
+				m_escalated = true;
+				m_stableFrames = 0;
+				box = m_boundingBox;
+			}
+		}
+
+		// 2. Use the expensive tracker until the point has been stable for a while.
+		if (m_escalated)
+		{
+			if (!m_expensiveTracker->update(frame, box))
+			{
+				m_score = 0.0f;
+				return false;
+			}
+			m_escalatedFrameCount++;
+			m_score = m_verifier->Evaluate(frame, box);
+			m_stableFrames = m_score >= EscalationScore ? m_stableFrames + 1 : 0;
+			if (m_stableFrames >= StableFrameCount)
+			{
+				m_cheapTracker->init(frame, box);
+				m_escalated = false;
+			}
+		}
+
+		KeepPreviousArea(frame, box);
+		m_boundingBox = box;
+		boundingBox = box;
+		return true;
+	}
+
+	float CascadeTracker::GetScore() const
+	{
+		return m_score;
+	}
+
+	int CascadeTracker::GetEscalatedFrameCount() const
+	{
+		return m_escalatedFrameCount;
+	}
+
+	float CascadeTracker::MeasureConfidence(const cv::Mat& image, const cv::Rect& boundingBox) const
+	{
+		if (const auto* scoredTracker = dynamic_cast<const ScoredTracker*>(m_cheapTracker.get()))
+			return scoredTracker->GetScore();
+		return m_verifier->Evaluate(image, boundingBox);
+	}
+
+	void CascadeTracker::KeepPreviousArea(const cv::Mat& frame, const cv::Rect& boundingBox)
+	{
+		const int size = KeptAreaScale * std::max(boundingBox.width, boundingBox.height);
+		m_previousAreaRect = cv::Rect(boundingBox.x + boundingBox.width / 2 - size / 2, boundingBox.y + boundingBox.height / 2 - size / 2, size, size) & cv::Rect(0, 0, frame.cols, frame.rows);
+		// copyTo reuses the buffer of the previous frame when the area keeps its size.
+		frame(m_previousAreaRect).copyTo(m_previousArea);
+		m_previousImageSize = frame.size();
+		m_previousImageType = frame.type();
+	}
+
+	cv::Mat CascadeTracker::GetPreviousImage() const
+	{
+		// Only built when escalating, which is rare by design.
+		cv::Mat image(m_previousImageSize, m_previousImageType, cv::Scalar::all(0));
+		if (!m_previousAreaRect.empty())
+			m_previousArea.copyTo(image(m_previousAreaRect));
+		return image;
+	}
+}
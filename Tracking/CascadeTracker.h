@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../common.h"
+#include <opencv2/core.hpp>
+#include "NccTracker.h"
+#include "ScoredTracker.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief Tracks a point with a cheap tracker, and escalates to an expensive one only on
+	 * the frames where the cheap tracker is not confident. Once the expensive tracker has
+	 * been confident for StableFrameCount frames, the cheap tracker takes over again from its
+	 * position.
+	 * The confidence is the score of the cheap tracker if it has one, or the normalized
+	 * cross-correlation of the tracked area with the area of the first frame otherwise.
+	 */
+	class CascadeTracker final : public ScoredTracker
+	{
+	public:
+		/**
+		 * \brief Below this confidence, the cheap tracker hands over to the expensive one.
+		 */
+		static constexpr float EscalationScore = 0.8f;
+		/**
+		 * \brief Number of consecutive confident frames after which the expensive tracker
+		 * hands back to the cheap one.
+		 */
+		static constexpr int StableFrameCount = 5;
+		/**
+		 * \brief Size of the area of the last frame kept to start the expensive tracker
+		 * from, as a multiple of the bounding box. Larger than the area any of the trackers
+		 * reads when it starts.
+		 */
+		static constexpr int KeptAreaScale = 5;
+
+		static cv::Ptr<CascadeTracker> Create(const cv::Ptr<cv::Tracker>& cheapTracker, const cv::Ptr<cv::Tracker>& expensiveTracker);
+
+		void init(cv::InputArray image, const cv::Rect& boundingBox) override;
+		bool update(cv::InputArray image, cv::Rect& boundingBox) override;
+		_NODISCARD float GetScore() const override;
+
+		/**
+		 * \brief Number of frames tracked by the expensive tracker since init.
+		 */
+		_NODISCARD int GetEscalatedFrameCount() const;
+
+	protected:
+		CascadeTracker(const cv::Ptr<cv::Tracker>& cheapTracker, const cv::Ptr<cv::Tracker>& expensiveTracker);
+
+	private:
+		_NODISCARD float MeasureConfidence(const cv::Mat& image, const cv::Rect& boundingBox) const;
+		/**
+		 * \brief Copies the area of the frame around the bounding box, to start the
+		 * expensive tracker from later.
+		 */
+		void KeepPreviousArea(const cv::Mat& frame, const cv::Rect& boundingBox);
+		/**
+		 * \brief Frame as large as the previous one, holding its kept area and black
+		 * elsewhere.
+		 */
+		_NODISCARD cv::Mat GetPreviousImage() const;
+
+		cv::Ptr<cv::Tracker> m_cheapTracker;
+		cv::Ptr<cv::Tracker> m_expensiveTracker;
+		/**
+		 * \brief Measures the confidence when the cheap tracker does not have a score, and
+		 * when the expensive tracker runs.
+		 */
+		cv::Ptr<NccTracker> m_verifier;
+		bool m_escalated;
+		int m_stableFrames;
+		int m_escalatedFrameCount;
+		/**
+		 * \brief Last position, and copy of the last frame around it, to start the expensive
+		 * tracker from when the cheap one loses confidence. The frame itself cannot be kept:
+		 * the images given to update may be reused by the caller.
+		 */
+		cv::Mat m_previousArea;
+		cv::Rect m_previousAreaRect;
+		cv::Size m_previousImageSize;
+		int m_previousImageType;
+		cv::Rect m_boundingBox;
+		float m_score;
+	};
+}
@@ -0,0 +1,160 @@
+#include "GoturnTracker.h"
+#include <algorithm>
+#include <mutex>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+	/**
+	 * \brief Serializes the forward passes that change the OpenCV thread count, so that
+	 * the trackers running concurrently do not overwrite each other's count.
+	 */
+	std::mutex threadCountMutex;
+}
+
+namespace Tracking
+{
+	const std::string BatchedGoturnTracker::ModelDefinition = "goturn.prototxt";
+	const std::string BatchedGoturnTracker::ModelWeights = "goturn.caffemodel";
+
+	BatchedGoturnTracker::BatchedGoturnTracker(const int roiSize, const int threadCount) :
+		m_net(cv::dnn::readNetFromCaffe(ModelDefinition, ModelWeights)),
+		m_roiSize(roiSize),
+		m_threadCount(threadCount),
+		m_previousImage(),
+		m_boundingBoxes()
+	{
+		m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+		m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+	}
+
+	void BatchedGoturnTracker::Initialize(const cv::Mat& image, const QVector<QPoint>& positions)
+	{
+		m_previousImage = image;
+		m_boundingBoxes.clear();
+		m_boundingBoxes.reserve(positions.size());
+		for (const QPoint& position : positions)
+		{
+			m_boundingBoxes.emplace_back(static_cast<float>(position.x() - m_roiSize / 2), static_cast<float>(position.y() - m_roiSize / 2),
+				static_cast<float>(m_roiSize), static_cast<float>(m_roiSize));
+		}
+	}
+
+	void BatchedGoturnTracker::Update(const FrameBundle& frame, std::vector<char>& succeeded)
+	{
+		const cv::Mat& image = frame.image;
+		const int pointCount = static_cast<int>(m_boundingBoxes.size());
+		succeeded.assign(pointCount, 0);
+
+		for (int batchStart = 0; batchStart < pointCount; batchStart += MaxBatchSize)
+		{
+			const int batchSize = std::min(MaxBatchSize, pointCount - batchStart);
+
+			// 1. Crop the same area in both frames, for all the points of the batch.
+			std::vector<cv::Rect2f> cropAreas(batchSize);
+			std::vector<cv::Mat> targets(batchSize);
+			std::vector<cv::Mat> searches(batchSize);
+			cv::parallel_for_(cv::Range(0, batchSize), [&](const cv::Range& range)
+				{
+					for (int i = range.start; i < range.end; i++)
+					{
+						cropAreas[i] = GetCropArea(m_boundingBoxes[batchStart + i]);
+						targets[i] = Crop(m_previousImage, cropAreas[i]);
+						searches[i] = Crop(image, cropAreas[i]);
+					}
+				});
+
+			// 2. A single forward pass for the whole batch.
+			m_net.setInput(cv::dnn::blobFromImages(targets, 1.0, cv::Size(), cv::Scalar::all(128), false), "data1");
+			m_net.setInput(cv::dnn::blobFromImages(searches, 1.0, cv::Size(), cv::Scalar::all(128), false), "data2");
+			const cv::Mat output = Forward().reshape(1, batchSize);
+
+			// 3. The network gives the corners of the new bounding box in the crop.
+			const cv::Rect2f imageArea(0.0f, 0.0f, static_cast<float>(image.cols), static_cast<float>(image.rows));
+			for (int i = 0; i < batchSize; i++)
+			{
+				const float* corners = output.ptr<float>(i);
+				const cv::Rect2f& crop = cropAreas[i];
+				const float scaleX = crop.width / InputSize;
+				const float scaleY = crop.height / InputSize;
+				const cv::Rect2f boundingBox = cv::Rect2f(crop.x + corners[0] * scaleX, crop.y + corners[1] * scaleY,
+					(corners[2] - corners[0]) * scaleX, (corners[3] - corners[1]) * scaleY) & imageArea;
+				if (boundingBox.width <= 0.0f || boundingBox.height <= 0.0f)
+					continue;
+				m_boundingBoxes[batchStart + i] = boundingBox;
+				succeeded[batchStart + i] = true;
+			}
+		}
+
+		m_previousImage = image;
+	}
+
+	cv::Mat BatchedGoturnTracker::Forward()
+	{
+		if (m_threadCount <= 0)
+			return m_net.forward("scale");
+
+		// The thread count of OpenCV is global: only change it during the pass.
+		const std::lock_guard<std::mutex> lock(threadCountMutex);
+		const int previousThreadCount = cv::getNumThreads();
+		cv::setNumThreads(m_threadCount);
+		try
+		{
+			cv::Mat output = m_net.forward("scale");
+			cv::setNumThreads(previousThreadCount);
+			return output;
+		}
+		catch (...)
+		{
+			cv::setNumThreads(previousThreadCount);
+			throw;
+		}
+	}
+
+	QPoint BatchedGoturnTracker::GetPosition(const int pointIndex) const
+	{
+		const cv::Rect2f& boundingBox = m_boundingBoxes[pointIndex];
+		return { cvRound(boundingBox.x + boundingBox.width / 2.0f), cvRound(boundingBox.y + boundingBox.height / 2.0f) };
+	}
+
+	float BatchedGoturnTracker::GetConfidence(int) const
+	{
+		return 1.0f;
+	}
+
+	Preprocessing BatchedGoturnTracker::GetPreprocessing() const
+	{
+		return Preprocessing{};
+	}
+
+	cv::Rect2f BatchedGoturnTracker::GetCropArea(const cv::Rect2f& boundingBox)
+	{
+		const cv::Point2f center(boundingBox.x + boundingBox.width / 2.0f, boundingBox.y + boundingBox.height / 2.0f);
+		const cv::Size2f size(boundingBox.width * CropScale, boundingBox.height * CropScale);
+		return { center.x - size.width / 2.0f, center.y - size.height / 2.0f, size.width, size.height };
+	}
+
+	cv::Mat BatchedGoturnTracker::Crop(const cv::Mat& image, const cv::Rect2f& area)
+	{
+		// Only the part of the area inside the image is copied, instead of padding the
+		// whole frame for each point.
+		const cv::Rect crop(cvFloor(area.x), cvFloor(area.y), std::max(cvRound(area.width), 1), std::max(cvRound(area.height), 1));
+		const cv::Rect inside = crop & cv::Rect(0, 0, image.cols, image.rows);
+		cv::Mat patch;
+		if (inside.empty())
+		{
+			// Nothing left to see: the nearest border pixel, everywhere.
+			const cv::Point nearest(std::clamp(crop.x, 0, image.cols - 1), std::clamp(crop.y, 0, image.rows - 1));
+			patch = cv::Mat(crop.size(), image.type(), cv::Scalar(image.at<cv::Vec3b>(nearest)));
+		}
+		else
+		{
+			cv::copyMakeBorder(image(inside), patch, inside.y - crop.y, crop.br().y - inside.br().y, inside.x - crop.x, crop.br().x - inside.br().x, cv::BORDER_REPLICATE);
+		}
+
+		cv::Mat resized;
+		cv::resize(patch, resized, cv::Size(InputSize, InputSize));
+		return resized;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../common.h"
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include "BatchedTracker.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief GOTURN tracker running a single network forward pass for all the points of a
+	 * frame, instead of one per point like cv::TrackerGOTURN. It uses the same model and
+	 * the same input normalization, but the convolutions run on batches, which is much
+	 * faster on CPU.
+	 * For each point, the network compares the area around its bounding box on the previous
+	 * frame with the same area on the new frame, and predicts the new bounding box.
+	 */
+	class BatchedGoturnTracker final : public BatchedTracker
+	{
+	public:
+		/**
+		 * \brief Size of the square crops the network takes, in pixels.
+		 */
+		static constexpr int InputSize = 227;
+		/**
+		 * \brief Maximum number of points in a forward pass, to bound the memory used by the
+		 * intermediate layers.
+		 */
+		static constexpr int MaxBatchSize = 32;
+		/**
+		 * \brief The crops are this many times larger than the bounding boxes, so that the
+		 * point can be found when it moved.
+		 */
+		static constexpr float CropScale = 2.0f;
+
+		/**
+		 * \param roiSize Size of the bounding boxes, in pixels.
+		 * \param threadCount Number of threads of the inference. 0 keeps the OpenCV default.
+		 * The OpenCV thread pool is shared by the whole process: the count is only set for
+		 * the duration of each forward pass, and restored after it.
+		 * \throw cv::Exception If the model cannot be loaded.
+		 */
+		BatchedGoturnTracker(int roiSize, int threadCount);
+
+		void Initialize(const cv::Mat& image, const QVector<QPoint>& positions) override;
+		void Update(const FrameBundle& frame, std::vector<char>& succeeded) override;
+		_NODISCARD QPoint GetPosition(int pointIndex) const override;
+		/**
+		 * \brief GOTURN has no confidence measure: always 1.
+		 */
+		_NODISCARD float GetConfidence(int pointIndex) const override;
+		/**
+		 * \brief GOTURN works on the colour image: nothing to preprocess.
+		 */
+		_NODISCARD Preprocessing GetPreprocessing() const override;
+
+		/**
+		 * \brief Files of the Caffe model, the same as the defaults of cv::TrackerGOTURN.
+		 */
+		static const std::string ModelDefinition;
+		static const std::string ModelWeights;
+
+	private:
+		/**
+		 * \brief Area around the bounding box of a point, cropped in both frames.
+		 */
+		_NODISCARD static cv::Rect2f GetCropArea(const cv::Rect2f& boundingBox);
+		/**
+		 * \brief Crops an area of the image, replicating the border pixels where it goes
+		 * out of the image, and resizes it to the input size of the network.
+		 */
+		_NODISCARD static cv::Mat Crop(const cv::Mat& image, const cv::Rect2f& area);
+		/**
+		 * \brief Runs the network with the thread count of the tracker.
+		 */
+		_NODISCARD cv::Mat Forward();
+
+		cv::dnn::Net m_net;
+		int m_roiSize;
+		int m_threadCount;
+		cv::Mat m_previousImage;
+		std::vector<cv::Rect2f> m_boundingBoxes;
+	};
+}
@@ -0,0 +1,93 @@
+#include "LucasKanadeTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+
+namespace Tracking
+{
+	LucasKanadeTracker::LucasKanadeTracker(const int windowSize) :
+		// The optical flow needs a few pixels of texture around each point.
+		m_windowSize(std::max(windowSize, 5), std::max(windowSize, 5)),
+		m_previousPyramid(),
+		m_points(),
+		m_confidences()
+	{
+	}
+
+	void LucasKanadeTracker::Initialize(const cv::Mat& image, const QVector<QPoint>& positions)
+	{
+		BuildPyramid(image, m_previousPyramid);
+		m_points.clear();
+		m_points.reserve(positions.size());
+		for (const QPoint& position : positions)
+		{
+			m_points.emplace_back(static_cast<float>(position.x()), static_cast<float>(position.y()));
+		}
+		m_confidences.assign(m_points.size(), 1.0f);
+	}
+
+	void LucasKanadeTracker::Update(const FrameBundle& frame, std::vector<char>& succeeded)
+	{
+		succeeded.assign(m_points.size(), 0);
+		std::vector<cv::Mat> ownPyramid;
+		if (frame.pyramid.empty())
+			BuildPyramid(frame.image, ownPyramid);
+		const std::vector<cv::Mat>& pyramid = frame.pyramid.empty() ? ownPyramid : frame.pyramid;
+
+		if (!m_points.empty())
+		{
+			// 1. Track all the points forward, then back to the previous frame.
+			const cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
+			std::vector<cv::Point2f> nextPoints;
+			std::vector<cv::Point2f> backPoints;
+			std::vector<uchar> status;
+			std::vector<uchar> backStatus;
+			std::vector<float> errors;
+			cv::calcOpticalFlowPyrLK(m_previousPyramid, pyramid, m_points, nextPoints, status, errors, m_windowSize, PyramidLevels, criteria);
+			cv::calcOpticalFlowPyrLK(pyramid, m_previousPyramid, nextPoints, backPoints, backStatus, errors, m_windowSize, PyramidLevels, criteria);
+
+			// 2. Only keep the points that came back where they started.
+			for (size_t i = 0; i < m_points.size(); i++)
+			{
+				const cv::Point2f difference = backPoints[i] - m_points[i];
+				const bool found = status[i] && backStatus[i] && difference.dot(difference) <= MaxForwardBackwardError * MaxForwardBackwardError;
+				if (found)
+				{
+					m_points[i] = nextPoints[i];
+					m_confidences[i] = 1.0f - std::sqrt(difference.dot(difference)) / MaxForwardBackwardError;
+				}
+				succeeded[i] = found;
+			}
+		}
+
+		m_previousPyramid = pyramid;
+	}
+
+	QPoint LucasKanadeTracker::GetPosition(const int pointIndex) const
+	{
+		const cv::Point2f& point = m_points[pointIndex];
+		return { cvRound(point.x), cvRound(point.y) };
+	}
+
+	float LucasKanadeTracker::GetConfidence(const int pointIndex) const
+	{
+		return m_confidences[pointIndex];
+	}
+
+	Preprocessing LucasKanadeTracker::GetPreprocessing() const
+	{
+		Preprocessing preprocessing;
+		preprocessing.gray = true;
+		preprocessing.pyramidLevels = PyramidLevels;
+		preprocessing.pyramidWindowSize = m_windowSize.width;
+		return preprocessing;
+	}
+
+	void LucasKanadeTracker::BuildPyramid(const cv::Mat& image, std::vector<cv::Mat>& pyramid) const
+	{
+		cv::Mat gray;
+		cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+		cv::buildOpticalFlowPyramid(gray, pyramid, m_windowSize, PyramidLevels);
+	}
+}
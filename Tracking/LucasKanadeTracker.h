@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../common.h"
+#include <vector>
+#include <opencv2/core.hpp>
+#include "BatchedTracker.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief Tracks all the points of a frame at once with a pyramidal Lucas-Kanade optical
+	 * flow. Unlike the OpenCV trackers, which each process the frame on their own, a single
+	 * image pyramid and a single optical flow call are shared by all the points, which
+	 * makes it suitable for hundreds of markers.
+	 * A point is considered lost when tracking it back from the new frame does not lead
+	 * to its previous position (forward-backward error).
+	 */
+	class LucasKanadeTracker final : public BatchedTracker
+	{
+	public:
+		/**
+		 * \brief Number of pyramid levels above the full-resolution one.
+		 */
+		static constexpr int PyramidLevels = 3;
+		/**
+		 * \brief Maximum distance, in pixels, between the position of a point and the
+		 * position found by tracking it forward then backward.
+		 */
+		static constexpr float MaxForwardBackwardError = 1.0f;
+
+		/**
+		 * \param windowSize Size of the search window at each pyramid level, in pixels.
+		 */
+		explicit LucasKanadeTracker(int windowSize);
+
+		void Initialize(const cv::Mat& image, const QVector<QPoint>& positions) override;
+		/**
+		 * \brief Tracks all the points on the next frame. Uses the pyramid of the bundle if
+		 * the pipeline built it, and builds it otherwise.
+		 */
+		void Update(const FrameBundle& frame, std::vector<char>& succeeded) override;
+		_NODISCARD QPoint GetPosition(int pointIndex) const override;
+		/**
+		 * \brief Confidence from the forward-backward error: 1 when the point came back
+		 * exactly, 0 at MaxForwardBackwardError.
+		 */
+		_NODISCARD float GetConfidence(int pointIndex) const override;
+		/**
+		 * \brief Asks the pipeline to build the pyramid of each frame, on its own thread.
+		 */
+		_NODISCARD Preprocessing GetPreprocessing() const override;
+
+	private:
+		void BuildPyramid(const cv::Mat& image, std::vector<cv::Mat>& pyramid) const;
+
+		cv::Size m_windowSize;
+		/**
+		 * \brief Pyramid of the previous frame.
+		 */
+		std::vector<cv::Mat> m_previousPyramid;
+		/**
+		 * \brief Sub-pixel positions of the points on the previous frame.
+		 */
+		std::vector<cv::Point2f> m_points;
+		std::vector<float> m_confidences;
+	};
+}
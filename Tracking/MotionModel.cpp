@@ -0,0 +1,88 @@
+#include "MotionModel.h"
+
+namespace Tracking
+{
+	std::unique_ptr<MotionModel> MotionModel::Create(const MotionModelType type)
+	{
+		switch (type)
+		{
+		case MotionModelType::ConstantVelocity:
+			return std::make_unique<ConstantVelocityModel>();
+		case MotionModelType::Kalman:
+			return std::make_unique<KalmanMotionModel>();
+		case MotionModelType::None:
+			break;
+		}
+		return nullptr;
+	}
+
+	ConstantVelocityModel::ConstantVelocityModel() :
+		MotionModel(),
+		m_position(),
+		m_velocity(),
+		m_cameraMotion()
+	{
+	}
+
+	void ConstantVelocityModel::Reset(const cv::Point2f& position)
+	{
+		m_position = position;
+		m_velocity = cv::Point2f();
+		m_cameraMotion = cv::Point2f();
+	}
+
+	cv::Point2f ConstantVelocityModel::Predict(const cv::Point2f& cameraMotion)
+	{
+		m_cameraMotion = cameraMotion;
+		return m_position + m_velocity + cameraMotion;
+	}
+
+	void ConstantVelocityModel::Correct(const cv::Point2f& position)
+	{
+		const cv::Point2f displacement = position - m_position - m_cameraMotion;
+		m_velocity = VelocitySmoothing * displacement + (1.0f - VelocitySmoothing) * m_velocity;
+		m_position = position;
+	}
+
+	KalmanMotionModel::KalmanMotionModel() :
+		MotionModel(),
+		m_filter(4, 2, 2, CV_32F)
+	{
+		m_filter.transitionMatrix = (cv::Mat_<float>(4, 4) <<
+			1, 0, 1, 0,
+			0, 1, 0, 1,
+			0, 0, 1, 0,
+			0, 0, 0, 1);
+		m_filter.controlMatrix = (cv::Mat_<float>(4, 2) <<
+			1, 0,
+			0, 1,
+			0, 0,
+			0, 0);
+		cv::setIdentity(m_filter.measurementMatrix);
+		// The positions are only disturbed through the velocities.
+		m_filter.processNoiseCov = cv::Mat::zeros(4, 4, CV_32F);
+		m_filter.processNoiseCov.at<float>(2, 2) = ProcessNoise;
+		m_filter.processNoiseCov.at<float>(3, 3) = ProcessNoise;
+		cv::setIdentity(m_filter.measurementNoiseCov, cv::Scalar::all(MeasurementNoise));
+	}
+
+	void KalmanMotionModel::Reset(const cv::Point2f& position)
+	{
+		m_filter.statePost = (cv::Mat_<float>(4, 1) << position.x, position.y, 0.0f, 0.0f);
+		// The start position is a keyframe: certain. The velocity is unknown.
+		m_filter.errorCovPost = cv::Mat::zeros(4, 4, CV_32F);
+		m_filter.errorCovPost.at<float>(2, 2) = 100.0f;
+		m_filter.errorCovPost.at<float>(3, 3) = 100.0f;
+	}
+
+	cv::Point2f KalmanMotionModel::Predict(const cv::Point2f& cameraMotion)
+	{
+		const cv::Mat prediction = m_filter.predict((cv::Mat_<float>(2, 1) << cameraMotion.x, cameraMotion.y));
+		return { prediction.at<float>(0), prediction.at<float>(1) };
+	}
+
+	void KalmanMotionModel::Correct(const cv::Point2f& position)
+	{
+		m_filter.correct((cv::Mat_<float>(2, 1) << position.x, position.y));
+	}
+}
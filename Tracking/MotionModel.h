@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../common.h"
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <QString>
+#include <QVector>
+
+namespace Tracking
+{
+	enum class MotionModelType
+	{
+		None,
+		ConstantVelocity,
+		Kalman
+	};
+
+	/**
+	 * \brief Names of the motion models, in the order of MotionModelType.
+	 */
+	inline QVector<QString> GetMotionModelNames()
+	{
+		return { "None", "Constant Velocity", "Kalman" };
+	}
+
+	/**
+	 * \brief Predicts where a point will be on the next frame from its past positions, so
+	 * that its tracker searches around the prediction instead of around the last position.
+	 * The motion of the camera, when it is estimated, is given separately: the model only
+	 * learns the motion of the point relative to the background, which is much smoother.
+	 * All the positions are in full-resolution pixels.
+	 */
+	class MotionModel
+	{
+	public:
+		/**
+		 * \return The model of the given type, or nullptr for MotionModelType::None.
+		 */
+		_NODISCARD static std::unique_ptr<MotionModel> Create(MotionModelType type);
+
+		MotionModel() = default;
+		virtual ~MotionModel() = default;
+		Q_DISABLE_COPY(MotionModel);
+
+		/**
+		 * \brief Starts again from a still point at the given position.
+		 */
+		virtual void Reset(const cv::Point2f& position) = 0;
+		/**
+		 * \brief Predicts the position of the point on the next frame.
+		 * \param cameraMotion Motion of the background from the last frame to the next one.
+		 */
+		_NODISCARD virtual cv::Point2f Predict(const cv::Point2f& cameraMotion) = 0;
+		/**
+		 * \brief Gives the position actually found on the frame of the last prediction.
+		 */
+		virtual void Correct(const cv::Point2f& position) = 0;
+	};
+
+	/**
+	 * \brief The point keeps the velocity it had, smoothed over the last frames since the
+	 * tracked positions are only known to a pixel.
+	 */
+	class ConstantVelocityModel final : public MotionModel
+	{
+	public:
+		/**
+		 * \brief Weight of the last displacement in the velocity.
+		 */
+		static constexpr float VelocitySmoothing = 0.5f;
+
+		ConstantVelocityModel();
+
+		void Reset(const cv::Point2f& position) override;
+		_NODISCARD cv::Point2f Predict(const cv::Point2f& cameraMotion) override;
+		void Correct(const cv::Point2f& position) override;
+
+	private:
+		cv::Point2f m_position;
+		cv::Point2f m_velocity;
+		cv::Point2f m_cameraMotion;
+	};
+
+	/**
+	 * \brief Kalman filter on the position and the velocity of the point, with the camera
+	 * motion as control input. Adapts to how noisy the tracker is, and ignores the odd
+	 * jump better than ConstantVelocityModel.
+	 */
+	class KalmanMotionModel final : public MotionModel
+	{
+	public:
+		/**
+		 * \brief Variance of the changes of velocity between two frames, in pixels².
+		 */
+		static constexpr float ProcessNoise = 0.5f;
+		/**
+		 * \brief Variance of the error of the tracked positions, in pixels².
+		 */
+		static constexpr float MeasurementNoise = 1.0f;
+
+		KalmanMotionModel();
+
+		void Reset(const cv::Point2f& position) override;
+		_NODISCARD cv::Point2f Predict(const cv::Point2f& cameraMotion) override;
+		void Correct(const cv::Point2f& position) override;
+
+	private:
+		/**
+		 * \brief State: x, y, vx, vy. Measurement: x, y. Control: camera motion x, y.
+		 */
+		cv::KalmanFilter m_filter;
+	};
+}
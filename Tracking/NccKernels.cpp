@@ -0,0 +1,124 @@
+#include "NccKernels.h"
+#include <opencv2/core/utility.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NCC_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	using Tracking::CorrelationKernel;
+
+	/**
+	 * \brief Plain C++ kernel. When Width is not 0, the row length is known at compile time
+	 * and the compiler can unroll the inner loop.
+	 */
+	template<int Width>
+	void CorrelateScalar(const float* image, const size_t imageStep, const float* templ, const int templateWidth, const int templateHeight,
+		float* result, const size_t resultStep, const int resultWidth, const int resultHeight)
+	{
+		const int width = Width > 0 ? Width : templateWidth;
+		for (int y = 0; y < resultHeight; y++)
+		{
+			for (int x = 0; x < resultWidth; x++)
+			{
+				float sum = 0.0f;
+				for (int row = 0; row < templateHeight; row++)
+				{
+					const float* imageRow = image + (y + row) * imageStep + x;
+					const float* templateRow = templ + row * width;
+					for (int column = 0; column < width; column++)
+					{
+						sum += imageRow[column] * templateRow[column];
+					}
+				}
+				result[y * resultStep + x] = sum;
+			}
+		}
+	}
+
+#ifdef NCC_HAS_SSE2
+	float HorizontalSum(const __m128 values)
+	{
+		const __m128 pairs = _mm_add_ps(values, _mm_movehl_ps(values, values));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+
+	template<int Width>
+	void CorrelateSse2(const float* image, const size_t imageStep, const float* templ, const int templateWidth, const int templateHeight,
+		float* result, const size_t resultStep, const int resultWidth, const int resultHeight)
+	{
+		const int width = Width > 0 ? Width : templateWidth;
+		const int vectorWidth = width - width % 4;
+		for (int y = 0; y < resultHeight; y++)
+		{
+			for (int x = 0; x < resultWidth; x++)
+			{
+				__m128 sum = _mm_setzero_ps();
+				float tailSum = 0.0f;
+				for (int row = 0; row < templateHeight; row++)
+				{
+					const float* imageRow = image + (y + row) * imageStep + x;
+					const float* templateRow = templ + row * width;
+					int column = 0;
+					for (; column < vectorWidth; column += 4)
+					{
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(imageRow + column), _mm_loadu_ps(templateRow + column)));
+					}
+					for (; column < width; column++)
+					{
+						tailSum += imageRow[column] * templateRow[column];
+					}
+				}
+				result[y * resultStep + x] = HorizontalSum(sum) + tailSum;
+			}
+		}
+	}
+#endif
+
+	CorrelationKernel GetScalarKernel(const int templateWidth)
+	{
+		switch (templateWidth)
+		{
+		case 16: return &CorrelateScalar<16>;
+		case 20: return &CorrelateScalar<20>;
+		case 24: return &CorrelateScalar<24>;
+		case 32: return &CorrelateScalar<32>;
+		case 48: return &CorrelateScalar<48>;
+		default: return &CorrelateScalar<0>;
+		}
+	}
+
+#ifdef NCC_HAS_SSE2
+	CorrelationKernel GetSse2Kernel(const int templateWidth)
+	{
+		switch (templateWidth)
+		{
+		case 16: return &CorrelateSse2<16>;
+		case 20: return &CorrelateSse2<20>;
+		case 24: return &CorrelateSse2<24>;
+		case 32: return &CorrelateSse2<32>;
+		case 48: return &CorrelateSse2<48>;
+		default: return &CorrelateSse2<0>;
+		}
+	}
+#endif
+}
+
+namespace Tracking
+{
+	CorrelationKernel GetCorrelationKernel(const int templateWidth)
+	{
+		if (cv::checkHardwareSupport(CV_CPU_AVX2) && cv::checkHardwareSupport(CV_CPU_FMA3))
+		{
+			if (const CorrelationKernel kernel = GetCorrelationKernelAvx2(templateWidth))
+				return kernel;
+		}
+#ifdef NCC_HAS_SSE2
+		if (cv::checkHardwareSupport(CV_CPU_SSE2))
+			return GetSse2Kernel(templateWidth);
+#endif
+		return GetScalarKernel(templateWidth);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Tracking
+{
+	/**
+	 * \brief Cross-correlation of a template with every position of it in an image: for each
+	 * offset (x, y), result(x, y) = sum of image(y + r, x + c) * template(r, c).
+	 * All the buffers are single-channel floats. The steps are in elements, not in bytes.
+	 * \param resultWidth Number of horizontal offsets: image width - template width + 1.
+	 * \param resultHeight Number of vertical offsets: image height - template height + 1.
+	 */
+	using CorrelationKernel = void (*)(const float* image, size_t imageStep,
+		const float* templ, int templateWidth, int templateHeight,
+		float* result, size_t resultStep, int resultWidth, int resultHeight);
+
+	/**
+	 * \brief Returns the fastest kernel for the given template width on this CPU. Common ROI
+	 * widths have kernels specialized at compile time, and the instruction set (AVX2, SSE2
+	 * or plain C++) is selected at runtime.
+	 */
+	CorrelationKernel GetCorrelationKernel(int templateWidth);
+
+	/**
+	 * \brief AVX2 kernels, implemented in a translation unit compiled for AVX2. Returns null
+	 * if the build does not include them. Must only be called on CPUs supporting AVX2 and FMA.
+	 */
+	CorrelationKernel GetCorrelationKernelAvx2(int templateWidth);
+}
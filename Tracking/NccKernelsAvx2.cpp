@@ -0,0 +1,83 @@
+#include "NccKernels.h"
+
+// This file is compiled with AVX2 enabled (see CMakeLists.txt), and its functions are only
+// called after checking the CPU supports it. It must not include any header defining inline
+// functions used elsewhere (the standard library, OpenCV...): the linker could keep their
+// AVX2 version for the whole program.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace
+{
+	using Tracking::CorrelationKernel;
+
+	float HorizontalSum(const __m256 values)
+	{
+		const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(values), _mm256_extractf128_ps(values, 1));
+		const __m128 pairs = _mm_add_ps(halves, _mm_movehl_ps(halves, halves));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+
+	/**
+	 * \brief When Width is not 0, the row length is known at compile time: the inner loop is
+	 * fully unrolled, and the tail loop disappears for multiples of 8.
+	 */
+	template<int Width>
+	void CorrelateAvx2(const float* image, const size_t imageStep, const float* templ, const int templateWidth, const int templateHeight,
+		float* result, const size_t resultStep, const int resultWidth, const int resultHeight)
+	{
+		const int width = Width > 0 ? Width : templateWidth;
+		const int vectorWidth = width - width % 8;
+		for (int y = 0; y < resultHeight; y++)
+		{
+			for (int x = 0; x < resultWidth; x++)
+			{
+				__m256 sum = _mm256_setzero_ps();
+				float tailSum = 0.0f;
+				for (int row = 0; row < templateHeight; row++)
+				{
+					const float* imageRow = image + (y + row) * imageStep + x;
+					const float* templateRow = templ + row * width;
+					int column = 0;
+					for (; column < vectorWidth; column += 8)
+					{
+						sum = _mm256_fmadd_ps(_mm256_loadu_ps(imageRow + column), _mm256_loadu_ps(templateRow + column), sum);
+					}
+					for (; column < width; column++)
+					{
+						tailSum += imageRow[column] * templateRow[column];
+					}
+				}
+				result[y * resultStep + x] = HorizontalSum(sum) + tailSum;
+			}
+		}
+	}
+}
+
+namespace Tracking
+{
+	CorrelationKernel GetCorrelationKernelAvx2(const int templateWidth)
+	{
+		switch (templateWidth)
+		{
+		case 16: return &CorrelateAvx2<16>;
+		case 20: return &CorrelateAvx2<20>;
+		case 24: return &CorrelateAvx2<24>;
+		case 32: return &CorrelateAvx2<32>;
+		case 48: return &CorrelateAvx2<48>;
+		default: return &CorrelateAvx2<0>;
+		}
+	}
+}
+
+#else
+
+namespace Tracking
+{
+	CorrelationKernel GetCorrelationKernelAvx2(int)
+	{
+		return nullptr;
+	}
+}
+
+#endif
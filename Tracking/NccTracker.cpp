@@ -0,0 +1,128 @@
+#include "NccTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+namespace Tracking
+{
+	cv::Ptr<NccTracker> NccTracker::Create()
+	{
+		return cv::Ptr<NccTracker>(new NccTracker());
+	}
+
+	NccTracker::NccTracker() :
+		m_template(),
+		m_templateNorm(0.0),
+		m_kernel(nullptr),
+		m_boundingBox(),
+		m_score(0.0f)
+	{
+	}
+
+	void NccTracker::init(cv::InputArray image, const cv::Rect& boundingBox)
+	{
+		const cv::Mat frame = image.getMat();
+		m_boundingBox = boundingBox & cv::Rect(0, 0, frame.cols, frame.rows);
+		ExtractGray(frame, m_boundingBox, m_template);
+		m_template -= cv::mean(m_template);
+		m_templateNorm = cv::norm(m_template);
+		m_kernel = GetCorrelationKernel(m_template.cols);
+		m_score = 1.0f;
+	}
+
+	bool NccTracker::update(cv::InputArray image, cv::Rect& boundingBox)
+	{
+		const cv::Mat frame = image.getMat();
+		if (m_template.empty() || m_templateNorm <= 0.0)
+			return false;
+
+		// 1. Only convert the search window: the rest of the frame is not needed.
+		const int margin = std::max(m_template.cols, m_template.rows) / 2;
+		const cv::Rect searchArea = cv::Rect(m_boundingBox.x - margin, m_boundingBox.y - margin,
+			m_template.cols + 2 * margin, m_template.rows + 2 * margin) & cv::Rect(0, 0, frame.cols, frame.rows);
+		if (searchArea.width < m_template.cols || searchArea.height < m_template.rows)
+			return false;
+		cv::Mat window;
+		ExtractGray(frame, searchArea, window);
+
+		// 2. Numerator: since the template is zero-mean, correlating it with the window gives
+		// the covariance of the template and each candidate, without removing their mean.
+		cv::Mat correlation(searchArea.height - m_template.rows + 1, searchArea.width - m_template.cols + 1, CV_32F);
+		m_kernel(window.ptr<float>(), window.step1(), m_template.ptr<float>(), m_template.cols, m_template.rows,
+			correlation.ptr<float>(), correlation.step1(), correlation.cols, correlation.rows);
+
+		// 3. Denominator: the norm of each zero-mean candidate, from the integral images in
+		// constant time per candidate.
+		cv::Mat sum, squaredSum;
+		cv::integral(window, sum, squaredSum, CV_64F, CV_64F);
+		const double area = static_cast<double>(m_template.cols) * m_template.rows;
+		float bestScore = -1.0f;
+		cv::Point bestOffset(-1, -1);
+		for (int y = 0; y < correlation.rows; y++)
+		{
+			const double* sumTop = sum.ptr<double>(y);
+			const double* sumBottom = sum.ptr<double>(y + m_template.rows);
+			const double* squaredTop = squaredSum.ptr<double>(y);
+			const double* squaredBottom = squaredSum.ptr<double>(y + m_template.rows);
+			const float* correlationRow = correlation.ptr<float>(y);
+			for (int x = 0; x < correlation.cols; x++)
+			{
+				const int right = x + m_template.cols;
+				const double candidateSum = sumBottom[right] - sumBottom[x] - sumTop[right] + sumTop[x];
+				const double candidateSquaredSum = squaredBottom[right] - squaredBottom[x] - squaredTop[right] + squaredTop[x];
+				const double variance = candidateSquaredSum - candidateSum * candidateSum / area;
+				if (variance <= 0.0)
+					continue;
+
+				const float score = static_cast<float>(correlationRow[x] / (m_templateNorm * std::sqrt(variance)));
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestOffset = cv::Point(x, y);
+				}
+			}
+		}
+
+		m_score = std::max(bestScore, 0.0f);
+		if (bestScore < MinScore)
+			return false;
+
+		m_boundingBox.x = searchArea.x + bestOffset.x;
+		m_boundingBox.y = searchArea.y + bestOffset.y;
+		boundingBox = m_boundingBox;
+		return true;
+	}
+
+	float NccTracker::GetScore() const
+	{
+		return m_score;
+	}
+
+	float NccTracker::Evaluate(const cv::Mat& image, const cv::Rect& area) const
+	{
+		if (m_template.empty() || m_templateNorm <= 0.0 || area.size() != m_template.size() || (area & cv::Rect(0, 0, image.cols, image.rows)) != area)
+			return 0.0f;
+
+		cv::Mat candidate;
+		ExtractGray(image, area, candidate);
+		candidate -= cv::mean(candidate);
+		const double candidateNorm = cv::norm(candidate);
+		if (candidateNorm <= 0.0)
+			return 0.0f;
+		return std::clamp(static_cast<float>(candidate.dot(m_template) / (m_templateNorm * candidateNorm)), 0.0f, 1.0f);
+	}
+
+	void NccTracker::ExtractGray(const cv::Mat& image, const cv::Rect& area, cv::Mat& gray)
+	{
+		const cv::Mat roi = image(area);
+		if (roi.channels() == 1)
+		{
+			roi.convertTo(gray, CV_32F);
+			return;
+		}
+
+		cv::Mat grayRoi;
+		cv::cvtColor(roi, grayRoi, roi.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+		grayRoi.convertTo(gray, CV_32F);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../common.h"
+#include <opencv2/core.hpp>
+#include "NccKernels.h"
+#include "ScoredTracker.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief Template tracker for small ROIs: searches the ROI of the first frame in a window
+	 * around its last position, with a normalized cross-correlation. Much cheaper than the
+	 * OpenCV trackers on markers that do not change much, and it reports its match score,
+	 * which can be used as the confidence of the tracked position.
+	 * The template is never updated, so the tracker does not drift, but it loses points
+	 * whose appearance changes.
+	 */
+	class NccTracker final : public ScoredTracker
+	{
+	public:
+		/**
+		 * \brief Below this score, the point is considered lost.
+		 */
+		static constexpr float MinScore = 0.6f;
+
+		static cv::Ptr<NccTracker> Create();
+
+		void init(cv::InputArray image, const cv::Rect& boundingBox) override;
+		bool update(cv::InputArray image, cv::Rect& boundingBox) override;
+
+		/**
+		 * \brief Score of the last match, clamped to [0, 1]. 1 is a perfect match.
+		 */
+		_NODISCARD float GetScore() const override;
+		/**
+		 * \brief Score of the template against the given area of an image, without moving
+		 * the tracker. Used to measure the confidence in the result of another tracker.
+		 * \return The score, clamped to [0, 1]. 0 if the area does not have the size of the
+		 * template or is outside of the image.
+		 */
+		_NODISCARD float Evaluate(const cv::Mat& image, const cv::Rect& area) const;
+
+	protected:
+		NccTracker();
+
+	private:
+		/**
+		 * \brief Converts a part of the image to single-channel floats.
+		 */
+		static void ExtractGray(const cv::Mat& image, const cv::Rect& area, cv::Mat& gray);
+
+		/**
+		 * \brief Zero-mean template, in continuous CV_32F.
+		 */
+		cv::Mat m_template;
+		/**
+		 * \brief Euclidean norm of the zero-mean template.
+		 */
+		double m_templateNorm;
+		CorrelationKernel m_kernel;
+		cv::Rect m_boundingBox;
+		float m_score;
+	};
+}
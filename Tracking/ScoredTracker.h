@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../common.h"
+#include <opencv2/video/tracking.hpp>
+
+namespace Tracking
+{
+	/**
+	 * \brief An OpenCV tracker that tells how confident it is in its last result. The
+	 * confidence is stored with the tracked keyframes.
+	 */
+	class ScoredTracker : public cv::Tracker
+	{
+	public:
+		/**
+		 * \brief Confidence in the last result of init or update, between 0 and 1.
+		 */
+		_NODISCARD virtual float GetScore() const = 0;
+	};
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace Tracking
+{
+	/**
+	 * \brief Bounded lock-free queue between exactly one producer thread and one consumer
+	 * thread. Pushing to a full queue and popping from an empty queue fail instead of
+	 * blocking: the caller decides how to wait.
+	 */
+	template<typename T>
+	class SpscQueue
+	{
+	public:
+		explicit SpscQueue(const size_t capacity) :
+			// One slot is always left empty, to tell a full queue from an empty one.
+			m_slots(capacity + 1),
+			m_head(0),
+			m_tail(0)
+		{
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		/**
+		 * \brief Producer side. Moves the item into the queue if there is room for it.
+		 * \return Whether the item was pushed. If not, the item is left untouched.
+		 */
+		bool TryPush(T&& item)
+		{
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			const size_t nextTail = Next(tail);
+			if (nextTail == m_head.load(std::memory_order_acquire))
+				return false;
+
+			m_slots[tail] = std::move(item);
+			m_tail.store(nextTail, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * \brief Consumer side. Moves the oldest item out of the queue if there is one.
+		 * \return Whether an item was popped.
+		 */
+		bool TryPop(T& item)
+		{
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+
+			item = std::move(m_slots[head]);
+			// Release what the moved-from slot may still hold (the buffers of a cv::Mat for
+			// instance) now rather than when the slot is reused.
+			m_slots[head] = T();
+			m_head.store(Next(head), std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * \brief Number of items in the queue. Exact from the consumer and producer threads
+		 * when the other side is idle, approximate otherwise.
+		 */
+		_NODISCARD size_t GetSize() const
+		{
+			const size_t head = m_head.load(std::memory_order_acquire);
+			const size_t tail = m_tail.load(std::memory_order_acquire);
+			return tail >= head ? tail - head : tail + m_slots.size() - head;
+		}
+
+		_NODISCARD size_t GetCapacity() const
+		{
+			return m_slots.size() - 1;
+		}
+
+	private:
+		_NODISCARD size_t Next(const size_t index) const
+		{
+			return index + 1 == m_slots.size() ? 0 : index + 1;
+		}
+
+		std::vector<T> m_slots;
+		/**
+		 * \brief Index of the next item to pop. Only written by the consumer. The indices
+		 * are on separate cache lines, so that the two threads do not keep invalidating
+		 * each other's cache.
+		 */
+		alignas(64) std::atomic<size_t> m_head;
+		/**
+		 * \brief Index of the next slot to push to. Only written by the producer.
+		 */
+		alignas(64) std::atomic<size_t> m_tail;
+	};
+}
@@ -0,0 +1,408 @@
+#include "TrackingEngine.h"
+#include <algorithm>
+#include "../Logging/Log.h"
+
+namespace Tracking
+{
+	TrackingEngine::TrackingEngine(const TrackerParams& params, QObject* parent) :
+		QObject(parent),
+		m_params(params),
+		m_source(),
+		m_jobs(),
+		m_nextJob(0),
+		m_totalFrameCount(0),
+		m_trackedFrameCount(0),
+		m_startTime(),
+		m_thread(),
+		m_running(false),
+		m_cancelRequested(false),
+		m_mutex(),
+		m_pauseCondition(),
+		m_paused(false),
+		m_pendingResults(),
+		m_lastImage(),
+		m_lastImageIndex(-1),
+		m_errors(),
+		m_statistics(),
+		m_lastReportTime()
+	{
+	}
+
+	TrackingEngine::~TrackingEngine()
+	{
+		Cancel();
+		Wait();
+	}
+
+	bool TrackingEngine::Start()
+	{
+		Cancel();
+		Wait();
+
+		// 1. Open a source of our own on the video: the one of the document is used by the
+		// GUI thread during the tracking.
+		m_source = m_params.document.GetVideo().CloneSource();
+		if (!m_source)
+		{
+			emit TrackingFailed("There is no video to track.");
+			return false;
+		}
+
+		// 2. Create the jobs here rather than on the workers: they read the tracked points.
+		m_jobs.clear();
+		try
+		{
+			if (m_params.retrackedPointIndex >= 0)
+				CreateRetrackingJob();
+			else if (m_params.parallelSegments)
+				CreateSegmentJobs();
+			else
+				AddJob(m_params.document.GetActivePointIndices(), m_params.startFrame, m_params.endFrame);
+		}
+		catch (const Data::NoKeyframeFoundException& ex)
+		{
+			emit TrackingFailed(ex.what());
+			return false;
+		}
+		catch (const cv::Exception& ex)
+		{
+			// The trackers could not be created: a neural network model is missing for
+			// instance.
+			emit TrackingFailed(QString("Could not create the trackers: ") + ex.what());
+			return false;
+		}
+		catch (const std::exception& ex)
+		{
+			// An unknown tracker type for instance.
+			emit TrackingFailed(ex.what());
+			return false;
+		}
+		if (m_jobs.empty())
+		{
+			emit TrackingFailed("There is nothing to track: place a keyframe on the points to track first.");
+			return false;
+		}
+
+		// 3. Start the workers.
+		m_nextJob = 0;
+		m_totalFrameCount = 0;
+		for (const Job& job : m_jobs)
+		{
+			m_totalFrameCount += job.trackingManager->GetEndFrame() - job.trackingManager->GetStartFrame();
+		}
+		m_trackedFrameCount = 0;
+		m_cancelRequested = false;
+		m_startTime = Clock::now();
+		{
+			std::lock_guard lock(m_mutex);
+			m_paused = false;
+			m_pendingResults.clear();
+			m_lastImage = cv::Mat();
+			m_lastImageIndex = -1;
+			m_errors.clear();
+			m_statistics = PipelineStatistics{};
+			m_lastReportTime = m_startTime;
+		}
+		m_running = true;
+		m_thread = std::thread(&TrackingEngine::Run, this);
+		emit Started();
+		return true;
+	}
+
+	void TrackingEngine::Wait()
+	{
+		if (m_thread.joinable())
+			m_thread.join();
+	}
+
+	bool TrackingEngine::IsRunning() const
+	{
+		return m_running;
+	}
+
+	bool TrackingEngine::IsPaused() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_paused;
+	}
+
+	PipelineStatistics TrackingEngine::GetPipelineStatistics() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_statistics;
+	}
+
+	QVector<TrackedFrame> TrackingEngine::TakeResults()
+	{
+		std::lock_guard lock(m_mutex);
+		QVector<TrackedFrame> results;
+		results.swap(m_pendingResults);
+		return results;
+	}
+
+	void TrackingEngine::CommitResults(const QVector<TrackedFrame>& results) const
+	{
+		for (const TrackedFrame& frame : results)
+		{
+			AutomaticTrackingManager::CommitFrame(m_params.document, frame);
+		}
+	}
+
+	cv::Mat TrackingEngine::GetLastImage(int& frameIndex)
+	{
+		std::lock_guard lock(m_mutex);
+		frameIndex = m_lastImageIndex;
+		return m_lastImage;
+	}
+
+	void TrackingEngine::Pause()
+	{
+		std::lock_guard lock(m_mutex);
+		m_paused = true;
+	}
+
+	void TrackingEngine::Resume()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_paused = false;
+		}
+		m_pauseCondition.notify_all();
+	}
+
+	void TrackingEngine::Cancel()
+	{
+		{
+			// Taking the lock ensures the workers are either before their wait, and see the
+			// flag, or in it, and get the notification.
+			std::lock_guard lock(m_mutex);
+			m_cancelRequested = true;
+		}
+		m_pauseCondition.notify_all();
+	}
+
+	void TrackingEngine::AddJob(const QVector<int>& pointIndices, const int startFrame, const int endFrame)
+	{
+		TrackerParams params = m_params;
+		params.startFrame = startFrame;
+		params.endFrame = endFrame;
+		Job job{ std::make_unique<AutomaticTrackingManager>(params, pointIndices), {} };
+		if (job.trackingManager->GetEndFrame() <= job.trackingManager->GetStartFrame())
+			return;
+
+		job.startPositions = job.trackingManager->GetStartPositions();
+		m_jobs.push_back(std::move(job));
+	}
+
+	void TrackingEngine::CreateSegmentJobs()
+	{
+		for (const int pointIndex : m_params.document.GetActivePointIndices())
+		{
+			const QVector<int> manualFrames = m_params.document.GetTrackedPoint(pointIndex).GetManualKeyframeIndices();
+			for (int i = 0; i < manualFrames.size(); i++)
+			{
+				// A segment starting before the range starts from the position of the point on
+				// the first frame of the range instead.
+				const int segmentEnd = i + 1 < manualFrames.size() ? manualFrames[i + 1] - 1 : m_params.endFrame;
+				const int startFrame = std::max(manualFrames[i], m_params.startFrame);
+				const int endFrame = std::min(segmentEnd, m_params.endFrame);
+				if (endFrame > startFrame)
+					AddJob({ pointIndex }, startFrame, endFrame);
+			}
+		}
+
+		// Longest segments first, so that a long segment does not start last and run alone
+		// on a single core at the end.
+		std::stable_sort(m_jobs.begin(), m_jobs.end(), [](const Job& a, const Job& b)
+			{
+				return a.trackingManager->GetEndFrame() - a.trackingManager->GetStartFrame() > b.trackingManager->GetEndFrame() - b.trackingManager->GetStartFrame();
+			});
+		qCDebug(LogTracking) << "Split the timeline into" << m_jobs.size() << "segments.";
+	}
+
+	void TrackingEngine::CreateRetrackingJob()
+	{
+		const int pointIndex = m_params.retrackedPointIndex;
+		const Data::TrackedPoint& trackedPoint = m_params.document.GetTrackedPoint(pointIndex);
+		const int endFrame = std::min(trackedPoint.GetTrackedRunEnd(m_params.startFrame), m_params.endFrame);
+		AddJob({ pointIndex }, m_params.startFrame, endFrame);
+		if (m_jobs.empty())
+			return;
+
+		for (const Data::Keyframe& keyframe : trackedPoint.GetKeyframesInRange(m_params.startFrame + 1, endFrame))
+		{
+			m_jobs.back().previousTrajectory.insert(keyframe.frameIndex, keyframe.position);
+		}
+		qCDebug(LogTracking) << "Re-tracking point" << trackedPoint.GetName() << "from frame" << m_params.startFrame << "to frame" << endFrame << "at most.";
+	}
+
+	void TrackingEngine::Run()
+	{
+		// Each job has its own decoder and trackers: besides the thread running it, its
+		// pipeline keeps a decode and a preprocess thread busy. The jobs are spread over as
+		// many threads as fit in the budget, and the rest of the budget of each job goes to
+		// its trackers. This thread runs jobs too.
+		const int coreCount = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+		const int threadBudget = m_params.threadBudget > 0 ? m_params.threadBudget : coreCount;
+		const int threadCount = std::clamp(threadBudget / (1 + TrackingPipeline::StageThreadCount), 1, std::max(static_cast<int>(m_jobs.size()), 1));
+		const int trackerThreads = std::max(threadBudget / threadCount - TrackingPipeline::StageThreadCount, 1);
+		for (Job& job : m_jobs)
+		{
+			job.trackingManager->SetTrackerThreads(trackerThreads);
+		}
+		const auto runJobs = [this]
+		{
+			for (int jobIndex = m_nextJob++; jobIndex < static_cast<int>(m_jobs.size()) && !m_cancelRequested; jobIndex = m_nextJob++)
+			{
+				RunJob(m_jobs[jobIndex]);
+			}
+		};
+		std::vector<std::thread> helpers;
+		for (int i = 1; i < threadCount; i++)
+		{
+			helpers.emplace_back(runJobs);
+		}
+		runJobs();
+		for (std::thread& helper : helpers)
+		{
+			helper.join();
+		}
+
+		// Flush the frames tracked since the last signal, and report the errors.
+		ReportProgress(true);
+		QString errors;
+		PipelineStatistics statistics;
+		{
+			std::lock_guard lock(m_mutex);
+			errors = m_errors.join("\n");
+			statistics = m_statistics;
+		}
+		statistics.Log();
+		if (!errors.isEmpty())
+			emit TrackingFailed(errors);
+		m_running = false;
+		emit Finished();
+	}
+
+	void TrackingEngine::RunJob(Job& job)
+	{
+		const auto fail = [this](const QString& message)
+		{
+			std::lock_guard lock(m_mutex);
+			m_errors.push_back(message);
+		};
+
+		// 1. Start the trackers on the first frame, then the pipeline on the next ones.
+		std::unique_ptr<Data::FrameSource> source = m_source->Clone();
+		cv::Mat startImage;
+		AutomaticTrackingManager& trackingManager = *job.trackingManager;
+		if (!source || !source->Read(trackingManager.GetStartFrame(), startImage))
+		{
+			fail(QString("Could not read frame ") + QString::number(trackingManager.GetStartFrame()) + ".");
+			return;
+		}
+		try
+		{
+			trackingManager.InitializeTrackers(startImage, job.startPositions);
+		}
+		catch (const cv::Exception& ex)
+		{
+			// The trackers check their region of interest and their model when they start.
+			fail(QString("Could not start the trackers at frame ") + QString::number(trackingManager.GetStartFrame()) + ": " + ex.what());
+			return;
+		}
+		catch (const std::exception& ex)
+		{
+			fail(ex.what());
+			return;
+		}
+		TrackingPipeline pipeline(std::move(source), trackingManager.GetPreprocessing());
+		pipeline.Start(trackingManager.GetStartFrame() + 1, trackingManager.GetEndFrame());
+
+		const bool keepLastImage = m_jobs.size() == 1;
+		int convergedFrameCount = 0;
+		FrameBundle bundle;
+		while (true)
+		{
+			// 2. Honour the pause and cancel requests.
+			{
+				std::unique_lock lock(m_mutex);
+				m_pauseCondition.wait(lock, [this] { return !m_paused || m_cancelRequested; });
+			}
+			if (m_cancelRequested)
+				break;
+
+			// 3. Track the next frame, decoded while the previous one was tracked.
+			if (!pipeline.Pop(bundle))
+			{
+				if (pipeline.GetFailedFrame() >= 0)
+					fail(QString("Could not read frame ") + QString::number(pipeline.GetFailedFrame()) + ".");
+				break;
+			}
+			TrackedFrame trackedFrame;
+			try
+			{
+				trackedFrame = trackingManager.TickTrackers(bundle);
+			}
+			catch (const TrackingException& ex)
+			{
+				fail(ex.what());
+				break;
+			}
+			catch (const cv::Exception& ex)
+			{
+				fail(QString("Tracking error at frame ") + QString::number(bundle.frameIndex) + ": " + ex.what());
+				break;
+			}
+
+			// 4. When re-tracking, stop once the old trajectory is joined: it is right from there.
+			if (!job.previousTrajectory.isEmpty())
+			{
+				const auto previous = job.previousTrajectory.constFind(trackedFrame.frameIndex);
+				const bool converged = previous != job.previousTrajectory.cend() && (previous.value() - trackedFrame.positions[0]).manhattanLength() <= ConvergenceDistance;
+				convergedFrameCount = converged ? convergedFrameCount + 1 : 0;
+			}
+
+			{
+				std::lock_guard lock(m_mutex);
+				m_pendingResults.push_back(std::move(trackedFrame));
+				if (keepLastImage)
+				{
+					m_lastImage = bundle.image;
+					m_lastImageIndex = bundle.frameIndex;
+				}
+			}
+			m_trackedFrameCount++;
+
+			// 5. Notify the receivers, without flooding them.
+			ReportProgress(false);
+			if (convergedFrameCount >= ConvergenceFrameCount)
+			{
+				qCDebug(LogTracking) << "The new trajectory joined the old one at frame" << bundle.frameIndex << ".";
+				break;
+			}
+		}
+
+		pipeline.Stop();
+		std::lock_guard lock(m_mutex);
+		m_statistics.Add(pipeline.GetStatistics());
+	}
+
+	void TrackingEngine::ReportProgress(const bool force)
+	{
+		const Clock::time_point now = Clock::now();
+		{
+			std::lock_guard lock(m_mutex);
+			if (!force && now - m_lastReportTime < std::chrono::milliseconds(ResultsInterval))
+				return;
+			m_lastReportTime = now;
+		}
+
+		// The lock is released before emitting: directly connected receivers call
+		// TakeResults.
+		const double elapsedSeconds = std::chrono::duration<double>(now - m_startTime).count();
+		const double framesPerSecond = elapsedSeconds > 0.0 ? m_trackedFrameCount / elapsedSeconds : 0.0;
+		emit ResultsAvailable();
+		emit ProgressChanged(m_trackedFrameCount, m_totalFrameCount, framesPerSecond);
+	}
+}
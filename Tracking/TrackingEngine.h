@@ -0,0 +1,213 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include "TrackingManager.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief Runs the automatic tracking on worker threads, as fast as the decoding and the
+	 * trackers allow. The frames come from TrackingPipelines reading the video through
+	 * their own frame sources, so the document video is never touched outside of the thread
+	 * that owns it, and the next frames are decoded while the current one is tracked.
+	 * The tracked positions are not written to the tracked points by the workers: they are
+	 * accumulated until TakeResults is called, which the owner does when ResultsAvailable
+	 * is emitted. The signals are emitted from the worker threads: receivers living in
+	 * another thread get them queued, at most every ResultsInterval milliseconds.
+	 *
+	 * The work is split into jobs, each tracking some points on a range of frames with its
+	 * own pipeline and trackers. By default, there is a single job tracking all the active
+	 * points on the range of the parameters. With TrackerParams::parallelSegments, there is
+	 * one job per point and per segment between two manual keyframes (clipped to the range),
+	 * and the jobs run in parallel.
+	 * With TrackerParams::retrackedPointIndex, there is a single job re-tracking the point
+	 * from its corrected keyframe over the tracked run that follows it. The job stops as
+	 * soon as the new trajectory joins the old one: the rest of the run is kept.
+	 */
+	class TrackingEngine final : public QObject
+	{
+		Q_OBJECT
+
+	public:
+		/**
+		 * \brief Minimum time between two ResultsAvailable/ProgressChanged signals, so that
+		 * the receiver is not flooded when the tracking is fast.
+		 */
+		static constexpr int ResultsInterval = 33;
+		/**
+		 * \brief When re-tracking, the new trajectory joins the old one when they are at most
+		 * this many pixels apart on ConvergenceFrameCount consecutive frames.
+		 */
+		static constexpr int ConvergenceDistance = 1;
+		static constexpr int ConvergenceFrameCount = 3;
+
+		explicit TrackingEngine(const TrackerParams& params, QObject* parent = nullptr);
+		~TrackingEngine() override;
+		Q_DISABLE_COPY_MOVE(TrackingEngine);
+
+		/**
+		 * \brief Creates the jobs and starts them on the worker threads. Stops the previous
+		 * run if there is one. Must be called from the thread of the document.
+		 * \return Whether the tracking could start. If not, TrackingFailed was emitted.
+		 */
+		bool Start();
+		/**
+		 * \brief Blocks until the worker threads end.
+		 */
+		void Wait();
+		_NODISCARD bool IsRunning() const;
+		_NODISCARD bool IsPaused() const;
+		/**
+		 * \brief Statistics of the pipelines of the last run, summed over all its jobs.
+		 * Only meaningful once the run is finished.
+		 */
+		_NODISCARD PipelineStatistics GetPipelineStatistics() const;
+
+		/**
+		 * \brief Returns the frames tracked since the last call. The frames of a job are in
+		 * order, but the jobs are interleaved.
+		 */
+		_NODISCARD QVector<TrackedFrame> TakeResults();
+		/**
+		 * \brief Writes tracked frames to the tracked points. Must be called from the thread
+		 * of the document.
+		 */
+		void CommitResults(const QVector<TrackedFrame>& results) const;
+		/**
+		 * \brief Image of the last tracked frame, so that it can be displayed without
+		 * decoding it again. Only kept when there is a single job: with several jobs, there
+		 * is no meaningful frame to show.
+		 * \param frameIndex Return param for the index of the image.
+		 * \return The image, or an empty image.
+		 */
+		_NODISCARD cv::Mat GetLastImage(int& frameIndex);
+
+	public slots:
+		void Pause();
+		void Resume();
+		/**
+		 * \brief Asks the workers to stop after their current frame. The frames tracked so
+		 * far are still available.
+		 */
+		void Cancel();
+
+	signals:
+		/**
+		 * \brief Emitted by Start once the workers are running, from the calling thread.
+		 */
+		void Started();
+		/**
+		 * \brief Emitted when new frames were tracked, and can be taken with TakeResults.
+		 */
+		void ResultsAvailable();
+		/**
+		 * \param trackedFrames Number of frames tracked so far, over all the jobs.
+		 * \param totalFrames Number of frames to track, over all the jobs.
+		 * \param framesPerSecond Average number of frames tracked per second since the start.
+		 */
+		void ProgressChanged(int trackedFrames, int totalFrames, double framesPerSecond);
+		/**
+		 * \brief Emitted when some points could not be tracked until the end of their
+		 * range, because they were lost or a frame could not be read. When the jobs run in
+		 * parallel, the other jobs are not stopped, and all the errors are reported at once
+		 * at the end. Finished is emitted right after.
+		 */
+		void TrackingFailed(const QString& message);
+		/**
+		 * \brief Emitted when the workers end, whatever the reason.
+		 */
+		void Finished();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		/**
+		 * \brief Tracking of some points on a range of frames, run by a single worker.
+		 */
+		struct Job
+		{
+			/**
+			 * \brief Trackers of the job. Their range is the range of the job.
+			 */
+			std::unique_ptr<AutomaticTrackingManager> trackingManager;
+			/**
+			 * \brief Positions of the points on the start frame, read when the job is created
+			 * since the workers cannot read the tracked points.
+			 */
+			QVector<QPoint> startPositions;
+			/**
+			 * \brief For a re-tracking job, positions of its single point before the
+			 * correction. Key: frame index. Empty otherwise.
+			 */
+			QMap<int, QPoint> previousTrajectory;
+		};
+
+		/**
+		 * \brief Adds a job tracking the given points on the given range, if the range is
+		 * not empty.
+		 */
+		void AddJob(const QVector<int>& pointIndices, int startFrame, int endFrame);
+		/**
+		 * \brief Creates a job for each active point and each of its segments: from each
+		 * manual keyframe to the frame before the next one, or to the end of the range.
+		 */
+		void CreateSegmentJobs();
+		/**
+		 * \brief Creates the job re-tracking TrackerParams::retrackedPointIndex after its
+		 * correction.
+		 */
+		void CreateRetrackingJob();
+		/**
+		 * \brief Body of the worker threads: runs jobs until there are none left.
+		 */
+		void Run();
+		void RunJob(Job& job);
+		/**
+		 * \brief Emits ResultsAvailable and ProgressChanged if the last emission is older than
+		 * ResultsInterval, or if force is set.
+		 */
+		void ReportProgress(bool force);
+
+		TrackerParams m_params;
+		/**
+		 * \brief Source on the video, cloned by each job for its pipeline.
+		 */
+		std::unique_ptr<Data::FrameSource> m_source;
+		std::vector<Job> m_jobs;
+		/**
+		 * \brief Index of the next job to run.
+		 */
+		std::atomic_int m_nextJob;
+		int m_totalFrameCount;
+		std::atomic_int m_trackedFrameCount;
+		Clock::time_point m_startTime;
+
+		/**
+		 * \brief The thread started by Start. It runs jobs like the others, and waits for
+		 * them at the end.
+		 */
+		std::thread m_thread;
+		std::atomic_bool m_running;
+		std::atomic_bool m_cancelRequested;
+		/**
+		 * \brief Guards all the members below.
+		 */
+		mutable std::mutex m_mutex;
+		std::condition_variable m_pauseCondition;
+		bool m_paused;
+		QVector<TrackedFrame> m_pendingResults;
+		cv::Mat m_lastImage;
+		int m_lastImageIndex;
+		QStringList m_errors;
+		PipelineStatistics m_statistics;
+		Clock::time_point m_lastReportTime;
+	};
+}
@@ -1,5 +1,13 @@
 #include "TrackingManager.h"
-#include <QDebug>
+#include <algorithm>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include "../Logging/Log.h"
+#include "../Profiling/Profiler.h"
+#include "CascadeTracker.h"
+#include "GoturnTracker.h"
+#include "LucasKanadeTracker.h"
+#include "NccTracker.h"
 
 #ifdef ENABLE_LEGACY_TRACKERS
 #include <opencv2/tracking/tracking_legacy.hpp>
@@ -9,6 +17,10 @@ namespace Tracking
 {
 	cv::Ptr<cv::Tracker> InitializeTracker(const QString& trackerType)
 	{
+		const int cascadeSeparator = trackerType.indexOf('>');
+		if (cascadeSeparator >= 0)
+			return CascadeTracker::Create(InitializeTracker(trackerType.left(cascadeSeparator)), InitializeTracker(trackerType.mid(cascadeSeparator + 1)));
+
 		if (trackerType == "MIL")
 			return cv::TrackerMIL::create();
 		if (trackerType == "KCF")
@@ -17,6 +29,8 @@ namespace Tracking
 			return cv::TrackerGOTURN::create();
 		if (trackerType == "CSRT")
 			return cv::TrackerCSRT::create();
+		if (trackerType == "NCC")
+			return NccTracker::Create();
 
 #ifdef ENABLE_LEGACY_TRACKERS
 		// Issue with those: they don't inherit cv::Tracker but cv::legacy::Tracker.
@@ -33,62 +47,309 @@ namespace Tracking
 		throw UnknownTrackerTypeException(trackerType);
 	}
 
-	PointTracker::PointTracker(Data::TrackedPoint& trackedPoint, const QString& trackerType) :
+	PointTracker::PointTracker(Data::TrackedPoint& trackedPoint, const QString& trackerType, const int downscaleLevels, const MotionModelType motionModel) :
 		m_cvTracker(InitializeTracker(trackerType)),
+		m_scoredTracker(dynamic_cast<const ScoredTracker*>(m_cvTracker.get())),
 		m_boudingBox(),
-		m_trackedPoint(trackedPoint)
+		m_trackedPoint(trackedPoint),
+		m_downscaleLevels(downscaleLevels),
+		m_roiSize(0),
+		m_position(),
+		m_template(),
+		m_templateAnchor(),
+		m_motionModel(MotionModel::Create(motionModel)),
+		m_offset()
 	{
 	}
 
-	void PointTracker::Tick(const cv::Mat& image, const int frameIndex)
+	bool PointTracker::Update(const cv::Mat& image, const cv::Mat& downscaledImage, const cv::Point2f& cameraMotion)
 	{
-		if (!m_cvTracker->update(image, m_boudingBox))
+		const Profiling::ScopedTimer timer("Tracker update");
+
+		// 1. Centre the search on the predicted position, in the coordinates of the tracker.
+		const int scale = 1 << m_downscaleLevels;
+		if (m_motionModel)
+		{
+			const cv::Point2f prediction = m_motionModel->Predict(cameraMotion) / static_cast<float>(scale);
+			m_offset = cv::Point(cvRound(prediction.x - (m_boudingBox.x + m_boudingBox.width / 2.0f)), cvRound(prediction.y - (m_boudingBox.y + m_boudingBox.height / 2.0f)));
+		}
+
+		// 2. Track.
+		if (!m_cvTracker->update(GetShiftedImage(m_downscaleLevels == 0 ? image : downscaledImage), m_boudingBox))
+			return false;
+		if (m_downscaleLevels > 0)
+		{
+			const cv::Rect boundingBox = m_boudingBox + m_offset;
+			const QPoint coarsePosition((boundingBox.x + boundingBox.width / 2) * scale + scale / 2, (boundingBox.y + boundingBox.height / 2) * scale + scale / 2);
+			Refine(image, coarsePosition);
+		}
+
+		// 3. Learn from where the point actually was.
+		if (m_motionModel)
 		{
-			throw TrackingException(m_trackedPoint.GetName(), frameIndex);
+			const QPoint position = GetPosition();
+			m_motionModel->Correct(cv::Point2f(static_cast<float>(position.x()), static_cast<float>(position.y())));
 		}
+		return true;
+	}
 
-		const int xCenter = m_boudingBox.x + m_boudingBox.width / 2;
-		const int yCenter = m_boudingBox.y + m_boudingBox.height / 2;
-		m_trackedPoint.AddKeyframe(Data::Keyframe{ QPoint(xCenter, yCenter), frameIndex });
-		qDebug() << "Tracking - Position of point" << m_trackedPoint.GetName() << "at frame" << frameIndex << "is (" << xCenter << "," << yCenter << ").";
+	QPoint PointTracker::GetPosition() const
+	{
+		if (m_downscaleLevels > 0)
+			return m_position;
+		const cv::Rect boundingBox = m_boudingBox + m_offset;
+		return { boundingBox.x + boundingBox.width / 2, boundingBox.y + boundingBox.height / 2 };
 	}
 
-	void PointTracker::Initialize(const cv::Mat& image, const int frameIndex, const int roiSize)
+	float PointTracker::GetConfidence() const
 	{
-		const Data::Keyframe currentKeyframe = m_trackedPoint.GetLastKeyframe(frameIndex);
-		const QPoint pos = currentKeyframe.position;
+		return m_scoredTracker ? m_scoredTracker->GetScore() : 1.0f;
+	}
 
-		m_boudingBox = cv::Rect(pos.x() - roiSize / 2, pos.y() - roiSize / 2, roiSize, roiSize);
-		m_cvTracker->init(image, m_boudingBox);
+	const Data::TrackedPoint& PointTracker::GetTrackedPoint() const
+	{
+		return m_trackedPoint;
+	}
+
+	void PointTracker::Initialize(const cv::Mat& image, const QPoint& position, const int roiSize)
+	{
+		m_offset = cv::Point();
+		if (m_motionModel)
+			m_motionModel->Reset(cv::Point2f(static_cast<float>(position.x()), static_cast<float>(position.y())));
+
+		if (m_downscaleLevels == 0)
+		{
+			m_boudingBox = cv::Rect(position.x() - roiSize / 2, position.y() - roiSize / 2, roiSize, roiSize);
+			m_cvTracker->init(image, m_boudingBox);
+			return;
+		}
+
+		const int scale = 1 << m_downscaleLevels;
+		const int downscaledRoiSize = std::max(roiSize / scale, MinDownscaledRoiSize);
+		m_boudingBox = cv::Rect(position.x() / scale - downscaledRoiSize / 2, position.y() / scale - downscaledRoiSize / 2, downscaledRoiSize, downscaledRoiSize);
+		m_cvTracker->init(Downscale(image, m_downscaleLevels), m_boudingBox);
+		m_roiSize = roiSize;
+		m_position = position;
+		SaveTemplate(image);
+	}
+
+	void PointTracker::Refine(const cv::Mat& image, const QPoint& coarsePosition)
+	{
+		// The coarse position is only known to a downscaled pixel: search a little more than
+		// that around it.
+		const int margin = 1 << m_downscaleLevels;
+		const cv::Rect window = cv::Rect(coarsePosition.x() - m_templateAnchor.x() - margin, coarsePosition.y() - m_templateAnchor.y() - margin,
+			m_template.cols + 2 * margin, m_template.rows + 2 * margin) & cv::Rect(0, 0, image.cols, image.rows);
+		if (m_template.empty() || window.width < m_template.cols || window.height < m_template.rows)
+		{
+			m_position = coarsePosition;
+		}
+		else
+		{
+			cv::Mat scores;
+			cv::matchTemplate(image(window), m_template, scores, cv::TM_CCOEFF_NORMED);
+			cv::Point bestMatch;
+			cv::minMaxLoc(scores, nullptr, nullptr, nullptr, &bestMatch);
+			m_position = QPoint(window.x + bestMatch.x + m_templateAnchor.x(), window.y + bestMatch.y + m_templateAnchor.y());
+		}
+		SaveTemplate(image);
+	}
+
+	void PointTracker::SaveTemplate(const cv::Mat& image)
+	{
+		// Copy the area: holding a view would keep the whole frame alive.
+		const cv::Rect area = cv::Rect(m_position.x() - m_roiSize / 2, m_position.y() - m_roiSize / 2, m_roiSize, m_roiSize) & cv::Rect(0, 0, image.cols, image.rows);
+		m_template = image(area).clone();
+		m_templateAnchor = QPoint(m_position.x() - area.x, m_position.y() - area.y);
+	}
+
+	cv::Mat PointTracker::GetShiftedImage(const cv::Mat& image) const
+	{
+		if (m_offset == cv::Point())
+			return image;
+
+		// The canvas is as large as the image, so that the coordinates of the tracker keep
+		// their meaning, but only the area around the bounding box is filled. It is shared
+		// by the trackers running on the same thread, and rewritten by the next of them:
+		// the cv::Trackers copy what they keep of their images.
+		thread_local cv::Mat canvas;
+		canvas.create(image.size(), image.type());
+		const cv::Rect imageArea(0, 0, image.cols, image.rows);
+		const int searchSize = SearchWindowScale * std::max(m_boudingBox.width, m_boudingBox.height);
+		const cv::Rect searchArea = cv::Rect(m_boudingBox.x + m_boudingBox.width / 2 - searchSize / 2, m_boudingBox.y + m_boudingBox.height / 2 - searchSize / 2, searchSize, searchSize) & imageArea;
+		const cv::Rect sourceArea = (searchArea + m_offset) & imageArea;
+		canvas(searchArea).setTo(cv::Scalar::all(0));
+		if (!sourceArea.empty())
+			image(sourceArea).copyTo(canvas(sourceArea - m_offset));
+		return canvas;
 	}
 
 	AutomaticTrackingManager::AutomaticTrackingManager(const TrackerParams& params) :
+		AutomaticTrackingManager(params, params.document.GetActivePointIndices())
+	{
+	}
+
+	AutomaticTrackingManager::AutomaticTrackingManager(const TrackerParams& params, const QVector<int>& pointIndices) :
 		m_params(params),
-		m_trackers()
+		m_startFrame(0),
+		m_endFrame(0),
+		m_trackerThreads(0),
+		m_pointIndices(pointIndices),
+		m_trackers(),
+		m_batchedTracker()
 	{
+		const int lastVideoFrame = std::max(params.document.GetVideo().GetFrameCount() - 1, 0);
+		m_startFrame = std::clamp(params.startFrame, 0, lastVideoFrame);
+		m_endFrame = std::clamp(params.endFrame, m_startFrame, lastVideoFrame);
+
+		if (IsBatchedTrackerType(params.trackerType) && (params.downscaleLevels != 0 || params.motionModel != MotionModelType::None || params.cameraMotion))
+			qCWarning(LogTracking) << "The" << params.trackerType << "tracker ignores the downscaling and the motion prediction.";
+		if (params.trackerType == "LK")
+		{
+			m_batchedTracker = std::make_unique<LucasKanadeTracker>(params.roiSize);
+			return;
+		}
+		if (params.trackerType == "GOTURN")
+		{
+			m_batchedTracker = std::make_unique<BatchedGoturnTracker>(params.roiSize, params.inferenceThreads);
+			return;
+		}
+
 		// Initialize the trackers: one for each target point.
-		const auto& trackedPointsIndices = m_params.document.GetActivePointIndices();
-		std::for_each(trackedPointsIndices.begin(), trackedPointsIndices.end(), [&params, this](const int pointIndex)
+		std::for_each(m_pointIndices.begin(), m_pointIndices.end(), [&params, this](const int pointIndex)
 			{
-				m_trackers.emplace_back(PointTracker(params.document.GetTrackedPoint(pointIndex), params.trackerType));
+				m_trackers.emplace_back(PointTracker(params.document.GetTrackedPoint(pointIndex), params.trackerType, params.downscaleLevels, params.motionModel));
 			});
 	}
 
-	void AutomaticTrackingManager::InitializeTrackers()
+	int AutomaticTrackingManager::GetStartFrame() const
 	{
-		std::for_each(m_trackers.begin(), m_trackers.end(), [this](PointTracker& tracker)
-			{
-				tracker.Initialize(m_params.document.GetVideo().GetCurrentImage(), m_params.document.GetVideo().GetCurrentFrameIndex(), m_params.roiSize);
-			});
+		return m_startFrame;
+	}
+
+	int AutomaticTrackingManager::GetEndFrame() const
+	{
+		return m_endFrame;
+	}
+
+	QVector<QPoint> AutomaticTrackingManager::GetStartPositions() const
+	{
+		QVector<QPoint> positions;
+		positions.reserve(m_pointIndices.size());
+		for (const int pointIndex : m_pointIndices)
+		{
+			positions.push_back(m_params.document.GetTrackedPoint(pointIndex).GetLastKeyframe(m_startFrame).position);
+		}
+		return positions;
+	}
+
+	void AutomaticTrackingManager::InitializeTrackers(const cv::Mat& image, const QVector<QPoint>& positions)
+	{
+		if (m_batchedTracker)
+		{
+			m_batchedTracker->Initialize(image, positions);
+			return;
+		}
+
+		for (size_t i = 0; i < m_trackers.size(); i++)
+		{
+			m_trackers[i].Initialize(image, positions[static_cast<int>(i)], m_params.roiSize);
+		}
+	}
+
+	void AutomaticTrackingManager::SetTrackerThreads(const int threadCount)
+	{
+		m_trackerThreads = threadCount;
 	}
 
-	void AutomaticTrackingManager::TickTrackers()
+	TrackedFrame AutomaticTrackingManager::TickTrackers(const FrameBundle& frame)
 	{
-		std::for_each(m_trackers.begin(), m_trackers.end(), [this](PointTracker& tracker)
+		const cv::Mat& image = frame.image;
+		const int frameIndex = frame.frameIndex;
+		if (m_batchedTracker)
+			return TickBatchedTracker(frame);
+
+		// 1. Update all the trackers concurrently. The OpenCV thread pool is used rather than
+		// a separate one: the parallel regions of the trackers themselves then run serially
+		// inside the workers, instead of spawning more threads than there are cores.
+		// A char is used instead of a bool: std::vector<bool> cannot be written concurrently.
+		// The downscaled image is built once for all the trackers, by the pipeline if it
+		// could.
+		const cv::Mat downscaledImage = m_params.downscaleLevels == 0 || !frame.downscaled.empty() ? frame.downscaled : Downscale(image, m_params.downscaleLevels);
+		std::vector<char> succeeded(m_trackers.size(), 0);
+		cv::parallel_for_(cv::Range(0, static_cast<int>(m_trackers.size())), [this, &image, &downscaledImage, &frame, &succeeded](const cv::Range& range)
 			{
-				tracker.Tick(m_params.document.GetVideo().GetCurrentImage(), m_params.document.GetVideo().GetCurrentFrameIndex());
-			});
-		
+				for (int i = range.start; i < range.end; i++)
+				{
+					try
+					{
+						succeeded[i] = m_trackers[i].Update(image, downscaledImage, frame.cameraMotion);
+					}
+					catch (const std::exception&)
+					{
+						succeeded[i] = false;
+					}
+				}
+			}, m_trackerThreads > 0 ? m_trackerThreads : -1);
+
+		// 2. Gather the results in the order of the trackers, so that they do not depend on
+		// the scheduling of the threads.
+		TrackedFrame trackedFrame{ frameIndex, m_startFrame, m_pointIndices, {}, {} };
+		trackedFrame.positions.reserve(static_cast<int>(m_trackers.size()));
+		trackedFrame.confidences.reserve(static_cast<int>(m_trackers.size()));
+		for (size_t i = 0; i < m_trackers.size(); i++)
+		{
+			if (!succeeded[i])
+				throw TrackingException(m_trackers[i].GetTrackedPoint().GetName(), frameIndex);
+			trackedFrame.positions.push_back(m_trackers[i].GetPosition());
+			trackedFrame.confidences.push_back(m_trackers[i].GetConfidence());
+		}
+		return trackedFrame;
+	}
+
+	Preprocessing AutomaticTrackingManager::GetPreprocessing() const
+	{
+		if (m_batchedTracker)
+			return m_batchedTracker->GetPreprocessing();
+
+		// The OpenCV trackers all work on the colour image.
+		Preprocessing preprocessing;
+		preprocessing.downscaleLevels = m_params.downscaleLevels;
+		preprocessing.cameraMotion = m_params.cameraMotion && m_params.motionModel != MotionModelType::None;
+		return preprocessing;
+	}
+
+	TrackedFrame AutomaticTrackingManager::TickBatchedTracker(const FrameBundle& frame)
+	{
+		const Profiling::ScopedTimer timer("Batched tracker update");
+
+		std::vector<char> succeeded;
+		m_batchedTracker->Update(frame, succeeded);
+
+		TrackedFrame trackedFrame{ frame.frameIndex, m_startFrame, m_pointIndices, {}, {} };
+		trackedFrame.positions.reserve(m_pointIndices.size());
+		trackedFrame.confidences.reserve(m_pointIndices.size());
+		for (int i = 0; i < m_pointIndices.size(); i++)
+		{
+			if (!succeeded[i])
+				throw TrackingException(m_params.document.GetTrackedPoint(m_pointIndices[i]).GetName(), frame.frameIndex);
+			trackedFrame.positions.push_back(m_batchedTracker->GetPosition(i));
+			trackedFrame.confidences.push_back(m_batchedTracker->GetConfidence(i));
+		}
+		return trackedFrame;
+	}
+
+	void AutomaticTrackingManager::CommitFrame(Data::Document& document, const TrackedFrame& frame)
+	{
+		const Profiling::ScopedTimer timer("Keyframe commit");
+
+		for (int i = 0; i < frame.pointIndices.size(); i++)
+		{
+			Data::TrackedPoint& trackedPoint = document.GetTrackedPoint(frame.pointIndices[i]);
+			const QPoint& position = frame.positions[i];
+			const float confidence = frame.confidences[i];
+			trackedPoint.AddKeyframe(Data::Keyframe{ position, frame.frameIndex, Data::KeyframeSource::Tracked, confidence, frame.seedFrame });
+		}
 	}
 
 	ManualTrackingManager::ManualTrackingManager(Data::Document& document) :
@@ -101,7 +362,7 @@ namespace Tracking
 	{
 		m_manuallyTrackedIndex = trackedPointId;
 		emit ManualTrackingStarted(m_document.GetTrackedPoint(trackedPointId).GetName());
-		qDebug() << "Manual tracking started for tracked point " << trackedPointId;
+		qCDebug(LogTracking) << "Manual tracking started for tracked point " << trackedPointId;
 	}
 
 	void ManualTrackingManager::OnImageClicked(const QPointF& position)
@@ -111,8 +372,10 @@ namespace Tracking
 
 		const int frameIndex = m_document.GetVideo().GetCurrentFrameIndex();
 		Data::TrackedPoint& point = m_document.GetTrackedPoint(m_manuallyTrackedIndex.value());
-		point.AddKeyframe(Data::Keyframe{ position.toPoint(), frameIndex });
+		point.AddKeyframe(Data::Keyframe{ position.toPoint(), frameIndex, Data::KeyframeSource::Manual, 1.0f, -1 });
 		emit KeyframeChanged();
+		if (point.GetTrackedRunEnd(frameIndex) > frameIndex)
+			emit KeyframeCorrected(m_manuallyTrackedIndex.value(), frameIndex);
 		m_document.GetVideo().ReadNextFrame(true);
 	}
 }
@@ -1,30 +1,141 @@
 #pragma once
 
 #include <opencv2/tracking.hpp>
+#include <QStringList>
 #include "../Data/Document.h"
+#include "BatchedTracker.h"
+#include "MotionModel.h"
+#include "ScoredTracker.h"
+#include "TrackingPipeline.h"
 
 namespace Tracking
 {
 	inline QVector<QString> GetTrackerTypes()
 	{
 #ifdef ENABLE_LEGACY_TRACKERS
-		return { "MIL", "KCF", "GOTURN", "CSRT", "TLD","MEDIANFLOW",  "MOSSE", "BOOSTING" };
+		return { "MIL", "KCF", "GOTURN", "CSRT", "NCC", "NCC>CSRT", "KCF>CSRT", "LK", "TLD","MEDIANFLOW",  "MOSSE", "BOOSTING" };
 #else
-		return { "MIL", "KCF", "GOTURN", "CSRT" };
+		return { "MIL", "KCF", "GOTURN", "CSRT", "NCC", "NCC>CSRT", "KCF>CSRT", "LK" };
 #endif
 
 	}
 
+	/**
+	 * \brief Whether the given tracker type tracks all the points together, instead of
+	 * using one cv::Tracker per point.
+	 */
+	inline bool IsBatchedTrackerType(const QString& trackerType)
+	{
+		return trackerType == "LK" || trackerType == "GOTURN";
+	}
+
+	/**
+	 * \brief Whether InitializeTracker or the AutomaticTrackingManager can create the given
+	 * tracker type: one of GetTrackerTypes, or a cascade "Cheap>Expensive" of two of them
+	 * that are cv::Trackers.
+	 */
+	inline bool IsValidTrackerType(const QString& trackerType)
+	{
+		const QVector<QString> trackerTypes = GetTrackerTypes();
+		if (trackerTypes.contains(trackerType))
+			return true;
+
+		const QStringList stages = trackerType.split('>');
+		if (stages.size() != 2)
+			return false;
+		for (const QString& stage : stages)
+		{
+			if (!trackerTypes.contains(stage) || stage.contains('>') || IsBatchedTrackerType(stage))
+				return false;
+		}
+		return true;
+	}
+
 	struct TrackerParams
 	{
 		int roiSize;
-		//int startFrame; // for future version
-		//int endFrame;
+		/**
+		 * \brief First frame of the tracked range. The trackers start from the positions of
+		 * the points on this frame, and the frames after it are tracked.
+		 */
+		int startFrame;
+		/**
+		 * \brief Last frame of the tracked range (inclusive). Clamped to the video.
+		 */
+		int endFrame;
 		QString trackerType;
 		Data::Document& document;
+		/**
+		 * \brief Instead of tracking from the current frame, track each segment between two
+		 * manual keyframes of a point independently, in parallel.
+		 */
+		bool parallelSegments{ false };
+		/**
+		 * \brief When not -1, only this point is tracked, from startFrame, and only on the
+		 * tracked keyframes following it: see TrackingEngine. Used to track a point again
+		 * after the user corrected its keyframe on startFrame.
+		 */
+		int retrackedPointIndex{ -1 };
+		/**
+		 * \brief Number of times the frames are halved before running the per-point
+		 * trackers, whose results are then refined at full resolution: see PointTracker.
+		 * Ignored by the batched trackers, which are already pyramidal.
+		 */
+		int downscaleLevels{ 0 };
+		/**
+		 * \brief Number of threads of the neural network trackers. 0 keeps the OpenCV
+		 * default. Only applies during their forward passes, which are then run one at a
+		 * time in the process.
+		 */
+		int inferenceThreads{ 0 };
+		/**
+		 * \brief Model predicting where each point will be, to centre the search of its
+		 * tracker there: see PointTracker. Ignored by the batched trackers.
+		 */
+		MotionModelType motionModel{ MotionModelType::None };
+		/**
+		 * \brief Estimate the motion of the camera on each frame, and add it to the
+		 * predictions of the motion model.
+		 */
+		bool cameraMotion{ false };
+		/**
+		 * \brief Number of threads the tracking may keep busy, the decoding included: see
+		 * TrackingEngine. 0 uses one per core. Lower it when several trackings run at once.
+		 */
+		int threadBudget{ 0 };
+	};
 
+	/**
+	 * \brief Result of the automatic tracking on one frame.
+	 */
+	struct TrackedFrame
+	{
+		int frameIndex{ 0 };
+		/**
+		 * \brief Frame the trackers were started from.
+		 */
+		int seedFrame{ -1 };
+		/**
+		 * \brief Indices of the tracked points, in the document.
+		 */
+		QVector<int> pointIndices;
+		/**
+		 * \brief Position of each tracked point, in the order of pointIndices.
+		 */
+		QVector<QPoint> positions;
+		/**
+		 * \brief Confidence of the tracker in each position, between 0 and 1, in the order
+		 * of pointIndices.
+		 */
+		QVector<float> confidences;
 	};
 
+	/**
+	 * \brief Creates the OpenCV tracker of the given type. Batched tracker types are not
+	 * cv::Trackers: they are created by the AutomaticTrackingManager.
+	 * A type of the form "Cheap>Expensive" creates a CascadeTracker, which runs the cheap
+	 * tracker and only escalates to the expensive one when its confidence drops.
+	 */
 	_NODISCARD cv::Ptr<cv::Tracker> InitializeTracker(const QString& trackerType);
 
 	class TrackingException final : public std::exception
@@ -63,30 +174,188 @@ namespace Tracking
 		std::string m_customMessage;
 	};
 
+	/**
+	 * \brief Tracks a point with an OpenCV tracker.
+	 * The tracker can run on a downscaled image, which costs much less memory bandwidth on
+	 * UHD footage. Its result is then refined at full resolution, by searching the area
+	 * around the point on the previous frame in a small window around the coarse position.
+	 *
+	 * With a motion model, the search of the tracker is centred on the predicted position
+	 * instead of the last one, so that a small ROI keeps up with a fast point. The OpenCV
+	 * trackers cannot be told where to search: they are given the image translated by the
+	 * difference instead, so that the point appears where they expect it. Only the area
+	 * they search is translated, in a canvas shared by the trackers of a thread: the
+	 * trackers must not keep the image they are given after init or update returns, and
+	 * copy what they need of it instead (see CascadeTracker).
+	 */
 	class PointTracker
 	{
 	public:
-		explicit PointTracker(Data::TrackedPoint& trackedPoint, const QString& trackerType);
+		/**
+		 * \brief The ROI of a tracker running on a downscaled image is never smaller than
+		 * this, in pixels, so that it keeps some texture to track.
+		 */
+		static constexpr int MinDownscaledRoiSize = 8;
+		/**
+		 * \brief Size of the area translated for the tracker when predicting, as a
+		 * multiple of its ROI. Larger than the area searched by any of the trackers.
+		 */
+		static constexpr int SearchWindowScale = 5;
+
+		/**
+		 * \param downscaleLevels Number of times the images are halved for the tracker.
+		 */
+		PointTracker(Data::TrackedPoint& trackedPoint, const QString& trackerType, int downscaleLevels = 0, MotionModelType motionModel = MotionModelType::None);
 
-		void Tick(const cv::Mat& image, int frameIndex);
-		void Initialize(const cv::Mat& image, int frameIndex, int roiSize);
+		/**
+		 * \param image Full-resolution image.
+		 */
+		void Initialize(const cv::Mat& image, const QPoint& position, int roiSize);
+
+		/**
+		 * \brief Finds the point in the given image, without touching the tracked point.
+		 * Can be called concurrently on different trackers, and from another thread than
+		 * the one owning the tracked point.
+		 * \param image Full-resolution image.
+		 * \param downscaledImage The image halved downscaleLevels times, shared by all the
+		 * trackers. Unused when the tracker runs at full resolution.
+		 * \param cameraMotion Motion of the background since the previous frame, added to
+		 * the prediction of the motion model.
+		 * \return Whether the point could be found.
+		 */
+		_NODISCARD bool Update(const cv::Mat& image, const cv::Mat& downscaledImage, const cv::Point2f& cameraMotion = cv::Point2f());
+		/**
+		 * \brief Position found by the last successful Update.
+		 */
+		_NODISCARD QPoint GetPosition() const;
+		/**
+		 * \brief Confidence of the tracker in its last result, between 0 and 1. Trackers
+		 * without a confidence measure always report 1 when they find the point.
+		 */
+		_NODISCARD float GetConfidence() const;
+		_NODISCARD const Data::TrackedPoint& GetTrackedPoint() const;
 
 	private:
+		/**
+		 * \brief Finds the area of the previous frame around the coarse position, and saves
+		 * the area around the refined position for the next frame.
+		 */
+		void Refine(const cv::Mat& image, const QPoint& coarsePosition);
+		/**
+		 * \brief Saves the area around the current position as the template of Refine.
+		 */
+		void SaveTemplate(const cv::Mat& image);
+		/**
+		 * \brief The image the tracker is given: the image translated by m_offset, around
+		 * the bounding box only. The image itself when the offset is null.
+		 */
+		_NODISCARD cv::Mat GetShiftedImage(const cv::Mat& image) const;
+
 		cv::Ptr<cv::Tracker> m_cvTracker;
+		/**
+		 * \brief m_cvTracker, if it has a confidence measure. Null otherwise.
+		 */
+		const ScoredTracker* m_scoredTracker;
 		cv::Rect m_boudingBox;
 		Data::TrackedPoint& m_trackedPoint;
+		int m_downscaleLevels;
+		int m_roiSize;
+		/**
+		 * \brief Full-resolution position, when the tracker runs on a downscaled image.
+		 */
+		QPoint m_position;
+		/**
+		 * \brief Full-resolution area around the point on the previous frame, and position
+		 * of the point in it.
+		 */
+		cv::Mat m_template;
+		QPoint m_templateAnchor;
+		/**
+		 * \brief Null without prediction.
+		 */
+		std::unique_ptr<MotionModel> m_motionModel;
+		/**
+		 * \brief Translation from the coordinates of the tracker (m_boudingBox) to the
+		 * coordinates of its images, since the tracker was given a translated image.
+		 */
+		cv::Point m_offset;
 	};
 
 	class AutomaticTrackingManager
 	{
 	public:
+		/**
+		 * \brief Creates a tracker for each active point of the document.
+		 */
 		explicit AutomaticTrackingManager(const TrackerParams& params);
+		/**
+		 * \brief Creates a tracker for each of the given points.
+		 */
+		AutomaticTrackingManager(const TrackerParams& params, const QVector<int>& pointIndices);
+
+		/**
+		 * \brief First frame of the tracked range, clamped to the video.
+		 */
+		_NODISCARD int GetStartFrame() const;
+		/**
+		 * \brief Last frame of the tracked range (inclusive), clamped to the video. Equal to
+		 * the start frame when there is nothing to track.
+		 */
+		_NODISCARD int GetEndFrame() const;
 
-		void InitializeTrackers();
-		void TickTrackers();
+		/**
+		 * \brief Positions the trackers should start from: the last keyframe of each point at
+		 * or before the start frame. Reads the tracked points: must be called from their
+		 * thread.
+		 * \throw Data::NoKeyframeFoundException If a point has no keyframe to start from.
+		 */
+		_NODISCARD QVector<QPoint> GetStartPositions() const;
+		/**
+		 * \brief Starts the trackers on the given image, at the given positions (one for
+		 * each tracker).
+		 */
+		void InitializeTrackers(const cv::Mat& image, const QVector<QPoint>& positions);
+		/**
+		 * \brief Sets the number of threads of the OpenCV pool the per-point trackers are
+		 * spread over. 0 lets OpenCV use all of them.
+		 */
+		void SetTrackerThreads(int threadCount);
+		/**
+		 * \brief Tracks all the points on the given frame. The trackers run concurrently on
+		 * the OpenCV thread pool. The tracked points are not modified, so this can run on a
+		 * worker thread: the result is written to the points by CommitFrame.
+		 * \throw TrackingException If a point could not be found.
+		 */
+		_NODISCARD TrackedFrame TickTrackers(const FrameBundle& frame);
+		/**
+		 * \brief Data the trackers need the pipeline to compute for each frame, besides the
+		 * decoded image.
+		 */
+		_NODISCARD Preprocessing GetPreprocessing() const;
+		/**
+		 * \brief Writes the positions of a tracked frame as keyframes of its tracked points.
+		 * Must be called from the thread of the document.
+		 */
+		static void CommitFrame(Data::Document& document, const TrackedFrame& frame);
 	private:
+		/**
+		 * \brief TickTrackers for the batched tracker types.
+		 */
+		_NODISCARD TrackedFrame TickBatchedTracker(const FrameBundle& frame);
+
 		TrackerParams m_params;
+		int m_startFrame;
+		int m_endFrame;
+		int m_trackerThreads;
+		QVector<int> m_pointIndices;
+		/**
+		 * \brief One tracker per point. Empty when a batched tracker is used.
+		 */
 		std::vector<PointTracker> m_trackers;
+		/**
+		 * \brief Tracker of all the points, for the batched tracker types. Null otherwise.
+		 */
+		std::unique_ptr<BatchedTracker> m_batchedTracker;
 	};
 
 
@@ -103,6 +372,11 @@ namespace Tracking
 
 	signals:
 		void KeyframeChanged();
+		/**
+		 * \brief Emitted when the user placed a keyframe in front of tracked keyframes,
+		 * which are probably wrong from there: see Data::TrackedPoint::GetTrackedRunEnd.
+		 */
+		void KeyframeCorrected(int pointIndex, int frameIndex);
 		void ManualTrackingStarted(const QString& poi);
 		void ManualTrackingEnded();
 
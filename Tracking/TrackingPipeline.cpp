@@ -0,0 +1,241 @@
+#include "TrackingPipeline.h"
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include "../Logging/Log.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double SecondsSince(const Clock::time_point& start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	/**
+	 * \brief Waits a little before trying a queue again. Yields first, since the other
+	 * stage usually answers within microseconds, then sleeps so a long wait (a paused
+	 * tracker for instance) does not burn a core.
+	 */
+	void Backoff(int& attempts)
+	{
+		if (++attempts < 64)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+}
+
+namespace Tracking
+{
+	cv::Mat Downscale(const cv::Mat& image, const int levels)
+	{
+		cv::Mat downscaled = image;
+		for (int i = 0; i < levels; i++)
+		{
+			cv::pyrDown(downscaled, downscaled);
+		}
+		return downscaled;
+	}
+
+	void PipelineStatistics::Add(const PipelineStatistics& other)
+	{
+		decode.Add(other.decode);
+		preprocess.Add(other.preprocess);
+		track.Add(other.track);
+		queueCapacity = other.queueCapacity;
+	}
+
+	void PipelineStatistics::Log() const
+	{
+		const auto logStage = [this](const char* name, const StageStatistics& statistics)
+		{
+			qCInfo(LogTracking).nospace() << "" << name << ": " << statistics.processedFrames << " frames, busy " << statistics.busySeconds
+				<< " s, starved " << statistics.starvedSeconds << " s, blocked " << statistics.blockedSeconds
+				<< " s, input queue " << statistics.GetAverageInputOccupancy() << "/" << queueCapacity << ".";
+		};
+		const bool hasPreprocessing = preprocess.processedFrames > 0;
+		logStage("decode", decode);
+		if (hasPreprocessing)
+			logStage("preprocess", preprocess);
+		logStage("track", track);
+
+		// The stage that was busy the longest is the one the others waited for.
+		const char* bottleneck = "decode";
+		double bottleneckSeconds = decode.busySeconds;
+		if (hasPreprocessing && preprocess.busySeconds > bottleneckSeconds)
+		{
+			bottleneck = "preprocess";
+			bottleneckSeconds = preprocess.busySeconds;
+		}
+		if (track.busySeconds > bottleneckSeconds)
+			bottleneck = "track";
+		qCInfo(LogTracking) << "The run was" << bottleneck << "bound.";
+	}
+
+	TrackingPipeline::TrackingPipeline(std::unique_ptr<Data::FrameSource> source, const Preprocessing& preprocessing, const int queueCapacity) :
+		m_source(std::move(source)),
+		m_preprocessing(preprocessing),
+		m_firstFrame(0),
+		m_lastFrame(-1),
+		m_decodedFrames(queueCapacity),
+		m_preprocessedFrames(queueCapacity),
+		m_decodeFinished(false),
+		m_preprocessFinished(false),
+		m_stopRequested(false),
+		m_failedFrame(-1),
+		m_decodeThread(),
+		m_preprocessThread(),
+		m_cameraMotionEstimator(),
+		m_statistics(),
+		m_lastPopTime(),
+		m_hasPopped(false)
+	{
+		m_statistics.queueCapacity = queueCapacity;
+	}
+
+	TrackingPipeline::~TrackingPipeline()
+	{
+		Stop();
+	}
+
+	void TrackingPipeline::Start(const int firstFrame, const int lastFrame)
+	{
+		m_firstFrame = firstFrame;
+		m_lastFrame = lastFrame;
+		m_decodeThread = std::thread(&TrackingPipeline::DecodeStage, this);
+		if (m_preprocessing.IsEnabled())
+			m_preprocessThread = std::thread(&TrackingPipeline::PreprocessStage, this);
+	}
+
+	void TrackingPipeline::Stop()
+	{
+		m_stopRequested = true;
+		if (m_decodeThread.joinable())
+			m_decodeThread.join();
+		if (m_preprocessThread.joinable())
+			m_preprocessThread.join();
+	}
+
+	bool TrackingPipeline::Pop(FrameBundle& bundle)
+	{
+		// The time since the previous Pop was spent by the caller tracking the frame.
+		StageStatistics& statistics = m_statistics.track;
+		if (m_hasPopped)
+			statistics.busySeconds += SecondsSince(m_lastPopTime);
+
+		const bool popped = m_preprocessing.IsEnabled()
+			? PopWhenAvailable(m_preprocessedFrames, m_preprocessFinished, bundle, statistics)
+			: PopWhenAvailable(m_decodedFrames, m_decodeFinished, bundle, statistics);
+		m_lastPopTime = Clock::now();
+		m_hasPopped = popped;
+		if (popped)
+			statistics.processedFrames++;
+		return popped;
+	}
+
+	int TrackingPipeline::GetFailedFrame() const
+	{
+		return m_failedFrame;
+	}
+
+	const PipelineStatistics& TrackingPipeline::GetStatistics() const
+	{
+		return m_statistics;
+	}
+
+	void TrackingPipeline::DecodeStage()
+	{
+		StageStatistics& statistics = m_statistics.decode;
+		for (int frameIndex = m_firstFrame; frameIndex <= m_lastFrame && !m_stopRequested; frameIndex++)
+		{
+			const Clock::time_point start = Clock::now();
+			FrameBundle bundle;
+			bundle.frameIndex = frameIndex;
+			if (!m_source->Read(frameIndex, bundle.image))
+			{
+				m_failedFrame = frameIndex;
+				break;
+			}
+			statistics.busySeconds += SecondsSince(start);
+			statistics.processedFrames++;
+
+			if (!PushWhenRoom(m_decodedFrames, std::move(bundle), statistics))
+				break;
+		}
+		m_decodeFinished = true;
+	}
+
+	void TrackingPipeline::PreprocessStage()
+	{
+		StageStatistics& statistics = m_statistics.preprocess;
+		FrameBundle bundle;
+		while (PopWhenAvailable(m_decodedFrames, m_decodeFinished, bundle, statistics))
+		{
+			const Clock::time_point start = Clock::now();
+			if (m_preprocessing.gray || m_preprocessing.pyramidLevels > 0 || m_preprocessing.cameraMotion)
+				cv::cvtColor(bundle.image, bundle.gray, cv::COLOR_BGR2GRAY);
+			if (m_preprocessing.cameraMotion)
+				bundle.cameraMotion = m_cameraMotionEstimator.Estimate(bundle.gray);
+			if (m_preprocessing.pyramidLevels > 0)
+			{
+				const cv::Size window(m_preprocessing.pyramidWindowSize, m_preprocessing.pyramidWindowSize);
+				cv::buildOpticalFlowPyramid(bundle.gray, bundle.pyramid, window, m_preprocessing.pyramidLevels);
+			}
+			if (m_preprocessing.downscaleLevels > 0)
+				bundle.downscaled = Downscale(bundle.image, m_preprocessing.downscaleLevels);
+			statistics.busySeconds += SecondsSince(start);
+			statistics.processedFrames++;
+
+			if (!PushWhenRoom(m_preprocessedFrames, std::move(bundle), statistics))
+				break;
+		}
+		m_preprocessFinished = true;
+	}
+
+	bool TrackingPipeline::PushWhenRoom(Queue& queue, FrameBundle&& bundle, StageStatistics& statistics) const
+	{
+		if (queue.TryPush(std::move(bundle)))
+			return true;
+
+		const Clock::time_point start = Clock::now();
+		int attempts = 0;
+		while (!queue.TryPush(std::move(bundle)))
+		{
+			if (m_stopRequested)
+				return false;
+			Backoff(attempts);
+		}
+		statistics.blockedSeconds += SecondsSince(start);
+		return true;
+	}
+
+	bool TrackingPipeline::PopWhenAvailable(Queue& queue, const std::atomic_bool& producerFinished, FrameBundle& bundle, StageStatistics& statistics) const
+	{
+		const size_t occupancy = queue.GetSize();
+		if (queue.TryPop(bundle))
+		{
+			statistics.inputOccupancySum += occupancy;
+			return true;
+		}
+
+		const Clock::time_point start = Clock::now();
+		int attempts = 0;
+		while (true)
+		{
+			// The producer pushes its last frame before setting the flag: check the queue
+			// once more after seeing it.
+			const bool finished = producerFinished;
+			if (queue.TryPop(bundle))
+				break;
+			if (finished || m_stopRequested)
+			{
+				statistics.starvedSeconds += SecondsSince(start);
+				return false;
+			}
+			Backoff(attempts);
+		}
+		statistics.starvedSeconds += SecondsSince(start);
+		return true;
+	}
+}
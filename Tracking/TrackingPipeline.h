@@ -0,0 +1,251 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "../Data/FrameSource.h"
+#include "CameraMotionEstimator.h"
+#include "SpscQueue.h"
+
+namespace Tracking
+{
+	/**
+	 * \brief A frame travelling through the tracking pipeline, with the data derived from it
+	 * by the preprocessing stage.
+	 */
+	struct FrameBundle
+	{
+		int frameIndex{ -1 };
+		/**
+		 * \brief Decoded frame, in BGR.
+		 */
+		cv::Mat image;
+		/**
+		 * \brief Grayscale version of the image. Empty if not requested.
+		 */
+		cv::Mat gray;
+		/**
+		 * \brief Optical flow pyramid of the grayscale image, as built by
+		 * cv::buildOpticalFlowPyramid. Empty if not requested.
+		 */
+		std::vector<cv::Mat> pyramid;
+		/**
+		 * \brief Image halved Preprocessing::downscaleLevels times, in BGR, for the trackers
+		 * working at a lower resolution. Empty if not requested.
+		 */
+		cv::Mat downscaled;
+		/**
+		 * \brief Translation of the background since the previous frame, in pixels. Zero
+		 * if not requested, and on the first frame of the pipeline.
+		 */
+		cv::Point2f cameraMotion;
+	};
+
+	/**
+	 * \brief Data computed once per frame by the preprocessing stage, and shared by all the
+	 * trackers.
+	 */
+	struct Preprocessing
+	{
+		bool gray{ false };
+		/**
+		 * \brief Number of pyramid levels above the full-resolution one. 0 means no pyramid.
+		 * Building a pyramid implies the grayscale conversion.
+		 */
+		int pyramidLevels{ 0 };
+		/**
+		 * \brief Window size of the optical flow that will use the pyramid.
+		 */
+		int pyramidWindowSize{ 21 };
+		/**
+		 * \brief Number of times the image is halved for FrameBundle::downscaled. 0 means no
+		 * downscaled image.
+		 */
+		int downscaleLevels{ 0 };
+		/**
+		 * \brief Estimate FrameBundle::cameraMotion. Implies the grayscale conversion.
+		 */
+		bool cameraMotion{ false };
+
+		_NODISCARD bool IsEnabled() const
+		{
+			return gray || pyramidLevels > 0 || downscaleLevels > 0 || cameraMotion;
+		}
+	};
+
+	/**
+	 * \brief Halves the image the given number of times, with a Gaussian pyramid.
+	 */
+	_NODISCARD cv::Mat Downscale(const cv::Mat& image, int levels);
+
+	/**
+	 * \brief Time spent by a stage of the pipeline, to find out which stage limits the
+	 * throughput.
+	 */
+	struct StageStatistics
+	{
+		int processedFrames{ 0 };
+		/**
+		 * \brief Time spent doing actual work.
+		 */
+		double busySeconds{ 0.0 };
+		/**
+		 * \brief Time spent waiting for the previous stage to produce a frame.
+		 */
+		double starvedSeconds{ 0.0 };
+		/**
+		 * \brief Time spent waiting for the next stage to make room in the queue.
+		 */
+		double blockedSeconds{ 0.0 };
+		/**
+		 * \brief Sum of the sizes of the input queue of the stage, sampled each time the
+		 * stage takes a frame.
+		 */
+		size_t inputOccupancySum{ 0 };
+
+		/**
+		 * \brief Average number of frames waiting in the input queue of the stage. Close
+		 * to the capacity when the stage is the bottleneck, close to 0 when a previous
+		 * stage is.
+		 */
+		_NODISCARD double GetAverageInputOccupancy() const
+		{
+			return processedFrames > 0 ? static_cast<double>(inputOccupancySum) / processedFrames : 0.0;
+		}
+
+		void Add(const StageStatistics& other)
+		{
+			processedFrames += other.processedFrames;
+			busySeconds += other.busySeconds;
+			starvedSeconds += other.starvedSeconds;
+			blockedSeconds += other.blockedSeconds;
+			inputOccupancySum += other.inputOccupancySum;
+		}
+	};
+
+	struct PipelineStatistics
+	{
+		StageStatistics decode;
+		StageStatistics preprocess;
+		/**
+		 * \brief The tracker stage runs on the thread consuming the pipeline: its busy time
+		 * is the time between two Pop calls.
+		 */
+		StageStatistics track;
+		int queueCapacity{ 0 };
+
+		/**
+		 * \brief Adds the statistics of another pipeline, when several pipelines run for
+		 * the same tracking.
+		 */
+		void Add(const PipelineStatistics& other);
+		/**
+		 * \brief Prints the statistics, and the stage that limited the throughput.
+		 */
+		void Log() const;
+	};
+
+	/**
+	 * \brief Feeds the tracker stage with frames decoded, and optionally preprocessed, on
+	 * separate threads. The stages are connected by bounded lock-free queues, so frame N+1
+	 * is decoded while frame N is tracked, and a slow tracker does not make the decoder
+	 * run away with memory.
+	 *
+	 *     decode thread -> [queue] -> preprocess thread -> [queue] -> Pop (tracker stage)
+	 *
+	 * The preprocessing stage only exists when some preprocessing is requested.
+	 */
+	class TrackingPipeline
+	{
+	public:
+		static constexpr int DefaultQueueCapacity = 8;
+		/**
+		 * \brief Number of threads a pipeline keeps busy, besides the one consuming it.
+		 */
+		static constexpr int StageThreadCount = 2;
+
+		/**
+		 * \param source Source the decode stage reads the frames from. Only used by the
+		 * decode thread.
+		 */
+		TrackingPipeline(std::unique_ptr<Data::FrameSource> source, const Preprocessing& preprocessing, int queueCapacity = DefaultQueueCapacity);
+		~TrackingPipeline();
+		Q_DISABLE_COPY(TrackingPipeline);
+
+		/**
+		 * \brief Starts the stage threads on the given range of frames (inclusive).
+		 */
+		void Start(int firstFrame, int lastFrame);
+		/**
+		 * \brief Stops the stage threads and waits for them. The statistics are complete
+		 * once this returns.
+		 */
+		void Stop();
+
+		/**
+		 * \brief Tracker stage side. Blocks until the next frame is ready.
+		 * \return False once all the frames were popped, when a frame could not be read or
+		 * when the pipeline is stopped.
+		 */
+		bool Pop(FrameBundle& bundle);
+
+		/**
+		 * \brief Index of the frame the decode stage could not read, or -1.
+		 */
+		_NODISCARD int GetFailedFrame() const;
+		/**
+		 * \brief Only meaningful once the pipeline is stopped.
+		 */
+		_NODISCARD const PipelineStatistics& GetStatistics() const;
+
+	private:
+		using Queue = SpscQueue<FrameBundle>;
+
+		void DecodeStage();
+		void PreprocessStage();
+		/**
+		 * \brief Pushes a bundle, waiting for room in the queue.
+		 * \return False if the pipeline was stopped while waiting.
+		 */
+		bool PushWhenRoom(Queue& queue, FrameBundle&& bundle, StageStatistics& statistics) const;
+		/**
+		 * \brief Pops a bundle, waiting for the producer of the queue.
+		 * \return False if the producer finished and the queue is empty, or if the
+		 * pipeline was stopped while waiting.
+		 */
+		bool PopWhenAvailable(Queue& queue, const std::atomic_bool& producerFinished, FrameBundle& bundle, StageStatistics& statistics) const;
+
+		std::unique_ptr<Data::FrameSource> m_source;
+		Preprocessing m_preprocessing;
+		int m_firstFrame;
+		int m_lastFrame;
+
+		Queue m_decodedFrames;
+		Queue m_preprocessedFrames;
+		std::atomic_bool m_decodeFinished;
+		std::atomic_bool m_preprocessFinished;
+		std::atomic_bool m_stopRequested;
+		std::atomic_int m_failedFrame;
+
+		std::thread m_decodeThread;
+		std::thread m_preprocessThread;
+		/**
+		 * \brief Only used by the preprocess thread, which sees the frames in order.
+		 */
+		CameraMotionEstimator m_cameraMotionEstimator;
+
+		/**
+		 * \brief Each stage only writes its own statistics.
+		 */
+		PipelineStatistics m_statistics;
+		/**
+		 * \brief Time at which the last Pop returned, to measure the tracker stage.
+		 */
+		std::chrono::steady_clock::time_point m_lastPopTime;
+		bool m_hasPopped;
+	};
+}
@@ -1,10 +1,12 @@
 #include "AutomaticTrackingDisplay.h"
 
-#include <QLabel>
+#include <algorithm>
+#include <QMessageBox>
 #include <QSpacerItem>
 #include <QVBoxLayout>
 
 #include "../Actions/TrackingCommands.h"
+#include "../Logging/Log.h"
 
 AutomaticTrackingDisplay::AutomaticTrackingDisplay(Data::Document& document, QUndoStack& undoStack, QWidget* parent) :
 	QWidget(parent),
@@ -12,7 +14,22 @@ AutomaticTrackingDisplay::AutomaticTrackingDisplay(Data::Document& document, QUn
 	m_undoStack(undoStack),
 	m_roiSizeField(new QSpinBox(this)),
 	m_trackerTypeField(new QComboBox(this)),
-	m_startTrackingBtn(new QPushButton("Start Tracking", this))
+	m_resolutionField(new QComboBox(this)),
+	m_inferenceThreadsField(new QSpinBox(this)),
+	m_motionModelField(new QComboBox(this)),
+	m_cameraMotionField(new QCheckBox("Compensate camera motion", this)),
+	m_parallelSegmentsField(new QCheckBox("Track segments in parallel", this)),
+	m_retrackCorrectionsField(new QCheckBox("Re-track corrected points", this)),
+	m_startFrameField(new QSpinBox(this)),
+	m_endFrameField(new QSpinBox(this)),
+	m_setEndFrameBtn(new QPushButton("Current", this)),
+	m_startTrackingBtn(new QPushButton("Start Tracking", this)),
+	m_progressBar(new QProgressBar(this)),
+	m_throughputLabel(new QLabel(this)),
+	m_pauseTrackingBtn(new QPushButton("Pause", this)),
+	m_cancelTrackingBtn(new QPushButton("Cancel", this)),
+	m_engine(),
+	m_retrackingEngine()
 {
 	m_roiSizeField->setValue(20);
 
@@ -22,7 +39,26 @@ AutomaticTrackingDisplay::AutomaticTrackingDisplay(Data::Document& document, QUn
 		{
 			m_trackerTypeField->addItem(type);
 		});
-	m_trackerTypeField->setCurrentIndex(trackerTypes.size() - 1);
+	m_trackerTypeField->setCurrentText("CSRT");
+	m_resolutionField->addItems({ "Full", "1/2", "1/4", "1/8" });
+	m_inferenceThreadsField->setRange(0, 256);
+	m_inferenceThreadsField->setSpecialValueText("Automatic");
+	m_inferenceThreadsField->setToolTip("Number of threads running the neural network of the GOTURN tracker.");
+	m_resolutionField->setToolTip("Run the trackers on downscaled frames, then refine the positions at full resolution. Much faster on UHD footage.");
+	m_motionModelField->addItems(Tracking::GetMotionModelNames().toList());
+	m_motionModelField->setToolTip("Search each point where its motion predicts it, instead of where it was. Lets a small ROI follow fast points.");
+	m_cameraMotionField->setToolTip("Estimate the motion of the camera on each frame, and add it to the predictions.");
+	OnTrackerTypeChanged();
+
+	m_parallelSegmentsField->setToolTip("Track each segment between two manual keyframes of the range independently, on all the cores, instead of tracking from the start frame.");
+	m_retrackCorrectionsField->setToolTip("When a tracked keyframe is corrected by hand, track the point again from there until it joins its previous trajectory.");
+	m_retrackCorrectionsField->setChecked(true);
+	m_startFrameField->setToolTip("The points are tracked from their position on this frame.");
+	m_setEndFrameBtn->setToolTip("Stop the tracking at the current frame.");
+	OnVideoLoaded();
+	m_progressBar->setValue(0);
+	m_pauseTrackingBtn->setEnabled(false);
+	m_cancelTrackingBtn->setEnabled(false);
 
 	QVBoxLayout* layout = new QVBoxLayout(this);
 	setLayout(layout);
@@ -30,13 +66,168 @@ AutomaticTrackingDisplay::AutomaticTrackingDisplay(Data::Document& document, QUn
 	layout->addWidget(m_trackerTypeField);
 	layout->addWidget(new QLabel("ROI Size"));
 	layout->addWidget(m_roiSizeField);
+	layout->addWidget(new QLabel("Tracking Resolution"));
+	layout->addWidget(m_resolutionField);
+	layout->addWidget(new QLabel("Inference Threads"));
+	layout->addWidget(m_inferenceThreadsField);
+	layout->addWidget(new QLabel("Motion Prediction"));
+	layout->addWidget(m_motionModelField);
+	layout->addWidget(m_cameraMotionField);
+	layout->addWidget(new QLabel("Start Frame"));
+	layout->addWidget(m_startFrameField);
+	layout->addWidget(new QLabel("End Frame"));
+	QHBoxLayout* endFrameLayout = new QHBoxLayout();
+	endFrameLayout->addWidget(m_endFrameField, 1);
+	endFrameLayout->addWidget(m_setEndFrameBtn);
+	layout->addLayout(endFrameLayout);
+	layout->addWidget(m_parallelSegmentsField);
+	layout->addWidget(m_retrackCorrectionsField);
 	layout->addWidget(m_startTrackingBtn);
+	layout->addWidget(m_progressBar);
+	layout->addWidget(m_throughputLabel);
+	QHBoxLayout* controlsLayout = new QHBoxLayout();
+	controlsLayout->addWidget(m_pauseTrackingBtn);
+	controlsLayout->addWidget(m_cancelTrackingBtn);
+	layout->addLayout(controlsLayout);
 	layout->addItem(new QSpacerItem(1, 1, QSizePolicy::Minimum, QSizePolicy::Expanding));
 
 	connect(m_startTrackingBtn, &QPushButton::clicked, this, &AutomaticTrackingDisplay::StartTracking);
+	connect(m_trackerTypeField, &QComboBox::currentTextChanged, this, &AutomaticTrackingDisplay::OnTrackerTypeChanged);
+	connect(m_motionModelField, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &AutomaticTrackingDisplay::OnTrackerTypeChanged);
+	connect(&m_document.GetVideo(), &Data::Video::VideoLoaded, this, &AutomaticTrackingDisplay::OnVideoLoaded);
+	connect(&m_document.GetVideo(), &Data::Video::FrameChanged, this, [this](const int frameIndex)
+		{
+			m_startFrameField->setValue(frameIndex);
+		});
+	connect(m_setEndFrameBtn, &QPushButton::clicked, this, [this]
+		{
+			m_endFrameField->setValue(m_document.GetVideo().GetCurrentFrameIndex());
+		});
+	connect(m_pauseTrackingBtn, &QPushButton::clicked, this, &AutomaticTrackingDisplay::TogglePause);
+	connect(m_cancelTrackingBtn, &QPushButton::clicked, this, [this]
+		{
+			if (m_engine)
+				m_engine->Cancel();
+		});
+}
+
+void AutomaticTrackingDisplay::StartTracking()
+{
+	// Only one tracking at a time: the points of the previous one would change under it.
+	if (m_engine && m_engine->IsRunning())
+		return;
+	if (m_retrackingEngine)
+	{
+		m_retrackingEngine->Cancel();
+		m_retrackingEngine->Wait();
+		static_cast<void>(m_retrackingEngine->TakeResults());
+	}
+
+	Actions::PerformAutomaticTrackingCommand* command = new Actions::PerformAutomaticTrackingCommand(m_document, m_trackerTypeField->currentText(), m_roiSizeField->value(),
+		m_startFrameField->value(), m_endFrameField->value(), m_parallelSegmentsField->isChecked(), m_resolutionField->currentIndex(), m_inferenceThreadsField->value(),
+		static_cast<Tracking::MotionModelType>(m_motionModelField->currentIndex()), m_cameraMotionField->isChecked());
+	// Connect before pushing: pushing the command starts the tracking.
+	ConnectEngine(command->GetEngine());
+	m_undoStack.push(command);
+}
+
+void AutomaticTrackingDisplay::RetrackPoint(const int pointIndex, const int correctedFrame)
+{
+	// The automatic tracking rewrites the point anyway.
+	if (!m_retrackCorrectionsField->isChecked() || (m_engine && m_engine->IsRunning()))
+		return;
+
+	// The previous correction is superseded: its re-tracking stops at the new manual
+	// keyframe in any case.
+	if (m_retrackingEngine)
+		m_retrackingEngine->Cancel();
+
+	Actions::RetrackPointCommand* command = new Actions::RetrackPointCommand(m_document, m_trackerTypeField->currentText(), m_roiSizeField->value(), pointIndex, correctedFrame, m_resolutionField->currentIndex(), m_inferenceThreadsField->value(),
+		static_cast<Tracking::MotionModelType>(m_motionModelField->currentIndex()), m_cameraMotionField->isChecked());
+	m_retrackingEngine = &command->GetEngine();
+	// The user is busy placing keyframes: a lost point is not worth a message box.
+	connect(m_retrackingEngine, &Tracking::TrackingEngine::TrackingFailed, this, [](const QString& message)
+		{
+			qCWarning(LogUi) << "Re-tracking stopped:" << message;
+		});
+	m_undoStack.push(command);
+}
+
+void AutomaticTrackingDisplay::OnVideoLoaded()
+{
+	const int lastFrame = std::max(m_document.GetVideo().GetFrameCount() - 1, 0);
+	m_startFrameField->setRange(0, lastFrame);
+	m_endFrameField->setRange(0, lastFrame);
+	m_startFrameField->setValue(m_document.GetVideo().GetCurrentFrameIndex());
+	m_endFrameField->setValue(lastFrame);
+}
+
+void AutomaticTrackingDisplay::OnTrackerTypeChanged()
+{
+	const QString trackerType = m_trackerTypeField->currentText();
+	const bool batched = Tracking::IsBatchedTrackerType(trackerType);
+	if (batched)
+	{
+		m_resolutionField->setCurrentIndex(0);
+		m_motionModelField->setCurrentIndex(static_cast<int>(Tracking::MotionModelType::None));
+		m_cameraMotionField->setChecked(false);
+	}
+	m_resolutionField->setEnabled(!batched);
+	m_motionModelField->setEnabled(!batched);
+	m_cameraMotionField->setEnabled(!batched && static_cast<Tracking::MotionModelType>(m_motionModelField->currentIndex()) != Tracking::MotionModelType::None);
+}
+
+void AutomaticTrackingDisplay::ConnectEngine(Tracking::TrackingEngine& engine)
+{
+	m_engine = &engine;
+
+	connect(&engine, &Tracking::TrackingEngine::Started, this, &AutomaticTrackingDisplay::OnTrackingStarted);
+	connect(&engine, &Tracking::TrackingEngine::ProgressChanged, this, &AutomaticTrackingDisplay::OnProgressChanged);
+	connect(&engine, &Tracking::TrackingEngine::Finished, this, &AutomaticTrackingDisplay::OnTrackingFinished);
+	connect(&engine, &Tracking::TrackingEngine::TrackingFailed, this, [this](const QString& message)
+		{
+			QMessageBox::warning(this, "Tracking Error", message);
+		});
 }
 
-void AutomaticTrackingDisplay::StartTracking() const
+void AutomaticTrackingDisplay::OnProgressChanged(const int trackedFrames, const int totalFrames, const double framesPerSecond)
 {
-	m_undoStack.push(new Actions::PerformAutomaticTrackingCommand(m_document, m_trackerTypeField->currentText(), m_roiSizeField->value()));
+	m_progressBar->setRange(0, std::max(totalFrames, 1));
+	m_progressBar->setValue(trackedFrames);
+	m_throughputLabel->setText(QString::number(framesPerSecond, 'f', 1) + " frames/s");
+}
+
+void AutomaticTrackingDisplay::OnTrackingStarted()
+{
+	m_progressBar->setValue(0);
+	m_throughputLabel->clear();
+	m_startTrackingBtn->setEnabled(false);
+	m_pauseTrackingBtn->setEnabled(true);
+	m_pauseTrackingBtn->setText("Pause");
+	m_cancelTrackingBtn->setEnabled(true);
+}
+
+void AutomaticTrackingDisplay::OnTrackingFinished()
+{
+	m_startTrackingBtn->setEnabled(true);
+	m_pauseTrackingBtn->setEnabled(false);
+	m_pauseTrackingBtn->setText("Pause");
+	m_cancelTrackingBtn->setEnabled(false);
+}
+
+void AutomaticTrackingDisplay::TogglePause()
+{
+	if (!m_engine)
+		return;
+
+	if (m_engine->IsPaused())
+	{
+		m_engine->Resume();
+		m_pauseTrackingBtn->setText("Pause");
+	}
+	else
+	{
+		m_engine->Pause();
+		m_pauseTrackingBtn->setText("Resume");
+	}
 }
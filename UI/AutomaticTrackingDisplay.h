@@ -2,10 +2,14 @@
 
 #include "../common.h"
 #include <QUndoStack>
+#include <QCheckBox>
 #include <QComboBox>
+#include <QLabel>
+#include <QPointer>
+#include <QProgressBar>
 #include <QSpinBox>
 #include <QPushButton>
-#include "../Tracking/TrackingManager.h"
+#include "../Tracking/TrackingEngine.h"
 
 class AutomaticTrackingDisplay : public QWidget
 {
@@ -16,13 +20,78 @@ public:
 	~AutomaticTrackingDisplay() override = default;
 	Q_DISABLE_COPY_MOVE(AutomaticTrackingDisplay);
 
+public slots:
+	/**
+	 * \brief Tracks the point again after the correction of its keyframe at the given
+	 * frame, with the selected tracker, if the re-tracking is enabled.
+	 */
+	void RetrackPoint(int pointIndex, int correctedFrame);
+
 private:
-	void StartTracking() const;
+	void StartTracking();
+	/**
+	 * \brief Resets the range to the whole video.
+	 */
+	void OnVideoLoaded();
+	/**
+	 * \brief Enables the options that apply to the selected tracker type. The batched
+	 * trackers ignore the resolution and the motion prediction: those are reset and
+	 * disabled, so that the commands are not labelled with options that had no effect.
+	 */
+	void OnTrackerTypeChanged();
+	/**
+	 * \brief Shows the progress of the given engine, and lets the pause and cancel buttons
+	 * control it.
+	 */
+	void ConnectEngine(Tracking::TrackingEngine& engine);
+	void OnProgressChanged(int trackedFrames, int totalFrames, double framesPerSecond);
+	void OnTrackingStarted();
+	void OnTrackingFinished();
+	void TogglePause();
 
 	Data::Document& m_document;
 	QUndoStack& m_undoStack;
 	QSpinBox* m_roiSizeField;
 	QComboBox* m_trackerTypeField;
+	/**
+	 * \brief Resolution the trackers run at. The index is the number of times the frames
+	 * are halved.
+	 */
+	QComboBox* m_resolutionField;
+	/**
+	 * \brief Number of threads of the neural network trackers. 0 means automatic.
+	 */
+	QSpinBox* m_inferenceThreadsField;
+	/**
+	 * \brief Motion model centring the search of the trackers. The index is the
+	 * Tracking::MotionModelType.
+	 */
+	QComboBox* m_motionModelField;
+	QCheckBox* m_cameraMotionField;
+	QCheckBox* m_parallelSegmentsField;
+	QCheckBox* m_retrackCorrectionsField;
+	/**
+	 * \brief First frame of the tracked range. Follows the current frame of the video.
+	 */
+	QSpinBox* m_startFrameField;
+	/**
+	 * \brief Last frame of the tracked range (inclusive).
+	 */
+	QSpinBox* m_endFrameField;
+	QPushButton* m_setEndFrameBtn;
 	QPushButton* m_startTrackingBtn;
+	QProgressBar* m_progressBar;
+	QLabel* m_throughputLabel;
+	QPushButton* m_pauseTrackingBtn;
+	QPushButton* m_cancelTrackingBtn;
+	/**
+	 * \brief Engine of the last tracking command. Owned by the undo stack: it becomes null
+	 * when the command is deleted.
+	 */
+	QPointer<Tracking::TrackingEngine> m_engine;
+	/**
+	 * \brief Engine of the last re-tracking command, if any.
+	 */
+	QPointer<Tracking::TrackingEngine> m_retrackingEngine;
 
 };
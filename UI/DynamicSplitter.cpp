@@ -1,8 +1,8 @@
 #include "DynamicSplitter.h"
 
 #include <QApplication>
-#include <QDebug>
 #include <algorithm>
+#include "../Logging/Log.h"
 
 // See https://forum.pythonguis.com/t/how-to-make-qsplitter-responds-to-double-clicking/480/2
 // for the original idea behind the collapse system implemented in this file.
@@ -20,7 +20,7 @@ void ClickableSplitterHandle::mousePressEvent(QMouseEvent* event)
 	const Qt::KeyboardModifiers pressedMods = QApplication::queryKeyboardModifiers();
 	DynamicSplitter* splitter = dynamic_cast<DynamicSplitter*>(parent());
 	if (splitter == nullptr)
-		qWarning() << "Error : ClickableSplitterHandle's handle is not a ClickableSplitter.";
+		qCWarning(LogUi) << "Error : ClickableSplitterHandle's handle is not a ClickableSplitter.";
 	else if (pressedMods & Qt::AltModifier)
 		splitter->Rotate(); // If alt is clicked, then request a swap.
 	else if (pressedMods & Qt::ControlModifier)
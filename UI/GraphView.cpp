@@ -7,6 +7,7 @@
 #include <QPainterPath>
 #include <QTime>
 #include <QDebug>
+#include "../Profiling/Profiler.h"
 
 template<typename T>
 T Abs(const T a)
@@ -72,7 +73,7 @@ void GraphView::mouseMoveEvent(QMouseEvent* evt)
 	m_playheadPosition = std::clamp(static_cast<int>(evt->localPos().x()), 0, width());
 	const int correspondingFrame = controlPosToFrame(m_playheadPosition);
 	if (correspondingFrame != video.GetCurrentFrameIndex())
-		video.ReadFrameAtIndex(correspondingFrame);
+		video.PreviewFrameAtIndex(correspondingFrame);
 	repaint();
 }
 
@@ -83,6 +84,12 @@ void GraphView::mouseReleaseEvent(QMouseEvent*)
 
 	m_movingPlayhead = false;
 	this->setCursor(Qt::ArrowCursor);
+
+	// The frames displayed while dragging may come from the low-resolution proxy: swap in
+	// the full-resolution frame now that the playhead stopped.
+	Data::Video& video = m_document.GetVideo();
+	if (video.IsPreviewFrame())
+		video.ReadFrameAtIndex(video.GetCurrentFrameIndex());
 	MovePlayheadToFrame(m_document.GetVideo().GetCurrentFrameIndex()); // Put the frame indicator at an actual, integer frame position.
 }
 
@@ -129,6 +136,8 @@ void GraphView::SmoothPlayheadMove(const double x)
 
 void GraphView::paintEvent(QPaintEvent*)
 {
+	const Profiling::ScopedTimer timer("GraphView paint");
+
 	QPainter painter(this);
 	painter.setRenderHint(QPainter::Antialiasing);
 
@@ -236,7 +245,7 @@ void GraphView::DrawCurves(QPainter& widgetPainter)
 	for (const auto& trackedPoint : trackedPoints)
 	{
 		std::optional<std::array<QPoint, 2>> previousPoints = std::nullopt;
-		for (const auto& [position, frameIndex] : trackedPoint->GetKeyframes())
+		for (const auto& [position, frameIndex, source, confidence, seedFrame] : trackedPoint->GetKeyframes())
 		{
 			pixmapPainter.setPen(QPen(trackedPoint->GetColor(), 1, Qt::SolidLine)); // Solid line for points and X curves.
 			const int xPos = frameToControlPos(frameIndex);
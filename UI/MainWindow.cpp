@@ -5,8 +5,9 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QFileInfo>
-#include <QDebug>
 #include "DynamicSplitter.h"
+#include "../Profiling/Profiler.h"
+#include "../Logging/Log.h"
 
 
 MainWindow::MainWindow(QWidget* parent) :
@@ -20,12 +21,15 @@ MainWindow::MainWindow(QWidget* parent) :
 	m_automaticTrackingDisplay(new AutomaticTrackingDisplay(m_document, m_undoStack)),
 	m_trackedPointsList(new TrackedPointsList(m_document, m_undoStack, m_trackingManager, this)),
 	m_graphView(new GraphView(m_document, m_trackingManager, this)),
+	m_profilingPanel(new ProfilingPanel(this)),
 	m_statusLabel(new QLabel("", this))
 {
 	ui->setupUi(this);
-	
+	Profiling::Profiler::GetInstance().SetEnabled(true);
+
 	ManualUiSetup();
 	ApplyUiSettings();
+	ApplyVideoSettings();
 
 	// File menu.
 	connect(ui->actionOpenProject, &QAction::triggered, this, &MainWindow::OpenProjectMenuItemClicked);
@@ -38,12 +42,16 @@ MainWindow::MainWindow(QWidget* parent) :
 	connect(ui->actionUndo, &QAction::triggered, &m_undoStack, &QUndoStack::undo);
 	connect(ui->actionRedo, &QAction::triggered, &m_undoStack, &QUndoStack::redo);
 
+	// Profiling menu.
+	connect(ui->actionExport_Chrome_Trace, &QAction::triggered, this, &MainWindow::ExportChromeTraceMenuItemClicked);
+
 	// Document.
 	connect(&m_document, &Data::Document::DocumentDirtinessChanged, this, &MainWindow::ComputeWindowTitle);
 
 	// Tracking manager.
 	connect(m_videoPlayer, &VideoPlayer::ImageClicked, &m_trackingManager, &Tracking::ManualTrackingManager::OnImageClicked);
 	connect(&m_trackingManager, &Tracking::ManualTrackingManager::ManualTrackingStarted, this, [this](const QString& pointName) {m_statusLabel->setText(QString("Manual tracking started for ") + pointName + "."); });
+	connect(&m_trackingManager, &Tracking::ManualTrackingManager::KeyframeCorrected, m_automaticTrackingDisplay, &AutomaticTrackingDisplay::RetrackPoint);
 	connect(&m_trackingManager, &Tracking::ManualTrackingManager::ManualTrackingEnded, this, [this] {m_statusLabel->setText(QString("Manual tracking stopped.")); });
 
 	m_videoPlayer->Render(0);
@@ -101,6 +109,14 @@ void MainWindow::ManualUiSetup()
 	GenerateRecentVideosMenu();
 	GenerateRecentProjectsMenu();
 
+	// Profiling statistics, hidden until asked for from the Profiling menu.
+	QDockWidget* profilingDock = new QDockWidget("Profiling Statistics", this);
+	profilingDock->setObjectName("profilingDock");
+	profilingDock->setWidget(m_profilingPanel);
+	addDockWidget(Qt::RightDockWidgetArea, profilingDock);
+	profilingDock->hide();
+	ui->menuProfiling->insertAction(ui->actionExport_Chrome_Trace, profilingDock->toggleViewAction());
+
 	// Status bar.
 	ui->statusbar->addWidget(m_statusLabel);
 }
@@ -112,6 +128,15 @@ void MainWindow::ApplyUiSettings()
 		setWindowState(Qt::WindowMaximized);
 }
 
+void MainWindow::ApplyVideoSettings()
+{
+	Data::Video& video = m_document.GetVideo();
+	video.SetFrameCacheBudget(m_typeSafeSettings.GetFrameCacheBudget());
+	video.SetReadAhead(m_typeSafeSettings.GetReadAheadFrames());
+	video.SetDiskCache(m_typeSafeSettings.IsDiskCacheEnabled(), m_typeSafeSettings.GetDiskCacheMaxSize());
+	video.SetProxyEnabled(m_typeSafeSettings.IsProxyEnabled());
+}
+
 void MainWindow::OpenProjectMenuItemClicked()
 {
 	const QString fileName = QFileDialog::getOpenFileName(
@@ -124,7 +149,7 @@ void MainWindow::OpenProjectMenuItemClicked()
 void MainWindow::OpenVideoMenuItemClicked()
 {
 	const QString fileName = QFileDialog::getOpenFileName(
-		this, "Open Video", "", "Video file (*.mp4 *.avi)");
+		this, "Open Video", "", "Video file (*.mp4 *.avi);;Image sequence (*.png *.jpg *.jpeg *.tif *.tiff *.bmp)");
 	OpenVideo(fileName);
 }
 
@@ -140,18 +165,51 @@ std::optional<QString> SaveAsCallback()
 
 void MainWindow::SaveMenuItemClicked()
 {
-	m_document.Save(&SaveAsCallback);
+	try
+	{
+		m_document.Save(&SaveAsCallback);
+	}
+	catch (std::exception& ex)
+	{
+		QMessageBox::warning(this, "Could not save the project.", ex.what());
+		return;
+	}
+	if (!m_document.GetFilePath().has_value())
+		return;
 	m_typeSafeSettings.AddRecentProject(m_document.GetFilePath().value());
 	GenerateRecentVideosMenu();
 }
 
 void MainWindow::SaveAsMenuItemClicked()
 {
-	m_document.Save(&SaveAsCallback, true);
+	try
+	{
+		m_document.Save(&SaveAsCallback, true);
+	}
+	catch (std::exception& ex)
+	{
+		QMessageBox::warning(this, "Could not save the project.", ex.what());
+		return;
+	}
+	if (!m_document.GetFilePath().has_value())
+		return;
 	m_typeSafeSettings.AddRecentProject(m_document.GetFilePath().value());
 	GenerateRecentVideosMenu();
 }
 
+void MainWindow::ExportChromeTraceMenuItemClicked()
+{
+	const QString fileName = QFileDialog::getSaveFileName(
+		this, "Export Chrome Trace", "", "Chrome Trace (*.json)");
+	if (fileName.isEmpty())
+		return;
+
+	if (!Profiling::Profiler::GetInstance().ExportChromeTrace(fileName))
+		QMessageBox::warning(this, "Could not write the trace.", fileName);
+	else
+		m_statusLabel->setText(QString("Trace exported to ") + fileName + ".");
+}
+
 void MainWindow::GenerateRecentProjectsMenu()
 {
 	ui->openRecentProjectMenu->clear();
@@ -235,6 +293,6 @@ void MainWindow::ComputeWindowTitle()
 
 MainWindow::~MainWindow()
 {
-	qDebug() << "MainWindow::~MainWindow()";
+	qCDebug(LogUi) << "MainWindow::~MainWindow()";
 	delete ui;
 }
@@ -3,6 +3,7 @@
 
 #include "../common.h"
 #include <QMainWindow>
+#include <QDockWidget>
 #include <QLabel>
 
 #include "TypeSafeSettings.h"
@@ -12,6 +13,7 @@
 #include "TrackedPointsList.h"
 #include "GraphView.h"
 #include "AutomaticTrackingDisplay.h"
+#include "ProfilingPanel.h"
 
 namespace Ui {
 	class MainWindow;
@@ -35,12 +37,14 @@ private:
 	// UI initialization.
 	void ManualUiSetup();
 	void ApplyUiSettings();
+	void ApplyVideoSettings();
 
 	// Menu bar management.
 	void OpenProjectMenuItemClicked();
 	void OpenVideoMenuItemClicked();
 	void SaveMenuItemClicked();
 	void SaveAsMenuItemClicked();
+	void ExportChromeTraceMenuItemClicked();
 
 	void GenerateRecentProjectsMenu();
 	void GenerateRecentVideosMenu();
@@ -64,6 +68,7 @@ private:
 	AutomaticTrackingDisplay* m_automaticTrackingDisplay;
 	TrackedPointsList* m_trackedPointsList;
 	GraphView* m_graphView;
+	ProfilingPanel* m_profilingPanel;
 	QLabel* m_statusLabel;
 };
 
@@ -0,0 +1,78 @@
+#include "ProfilingPanel.h"
+
+#include <QHeaderView>
+#include <QVBoxLayout>
+
+#include "../Profiling/Profiler.h"
+
+ProfilingPanel::ProfilingPanel(QWidget* parent) :
+	QWidget(parent),
+	m_table(new QTableWidget(0, 5, this)),
+	m_droppedEventsLabel(new QLabel(this)),
+	m_clearBtn(new QPushButton("Clear", this)),
+	m_refreshTimer(this)
+{
+	m_table->setHorizontalHeaderLabels({ "Section", "Calls", "p50 (ms)", "p99 (ms)", "Max (ms)" });
+	m_table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+	m_table->verticalHeader()->hide();
+	m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_table->setSelectionMode(QAbstractItemView::NoSelection);
+	m_clearBtn->setToolTip("Forget the statistics and the trace recorded so far.");
+
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	setLayout(layout);
+	layout->addWidget(m_table);
+	QHBoxLayout* footerLayout = new QHBoxLayout();
+	footerLayout->addWidget(m_droppedEventsLabel, 1);
+	footerLayout->addWidget(m_clearBtn);
+	layout->addLayout(footerLayout);
+
+	connect(&m_refreshTimer, &QTimer::timeout, this, &ProfilingPanel::Refresh);
+	connect(m_clearBtn, &QPushButton::clicked, this, [this]
+		{
+			Profiling::Profiler::GetInstance().Clear();
+			Refresh();
+		});
+	m_refreshTimer.start(RefreshInterval);
+}
+
+void ProfilingPanel::showEvent(QShowEvent* event)
+{
+	QWidget::showEvent(event);
+	Refresh();
+}
+
+void ProfilingPanel::Refresh()
+{
+	Profiling::Profiler& profiler = Profiling::Profiler::GetInstance();
+	profiler.Collect();
+	if (!isVisible())
+		return;
+
+	const QVector<Profiling::SectionStatistics> statistics = profiler.GetStatistics();
+
+	m_table->setRowCount(statistics.size());
+	const auto setCell = [this](const int row, const int column, const QString& text)
+	{
+		QTableWidgetItem* item = m_table->item(row, column);
+		if (!item)
+		{
+			item = new QTableWidgetItem();
+			item->setTextAlignment(column == 0 ? Qt::AlignLeft | Qt::AlignVCenter : Qt::AlignRight | Qt::AlignVCenter);
+			m_table->setItem(row, column, item);
+		}
+		item->setText(text);
+	};
+	for (int row = 0; row < statistics.size(); row++)
+	{
+		const Profiling::SectionStatistics& section = statistics[row];
+		setCell(row, 0, section.name);
+		setCell(row, 1, QString::number(section.callCount));
+		setCell(row, 2, QString::number(section.medianMilliseconds, 'f', 3));
+		setCell(row, 3, QString::number(section.p99Milliseconds, 'f', 3));
+		setCell(row, 4, QString::number(section.maxMilliseconds, 'f', 3));
+	}
+
+	const int64_t droppedEvents = profiler.GetDroppedEventCount();
+	m_droppedEventsLabel->setText(droppedEvents > 0 ? QString::number(droppedEvents) + " events dropped." : QString());
+}
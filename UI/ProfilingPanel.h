@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../common.h"
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+
+/**
+ * \brief Live view of the timed sections of the Profiler: rolling median and 99th
+ * percentile of their durations. The panel also collects the profiler periodically
+ * while it is hidden, so that the threads never drop events and the trace export covers
+ * the whole session.
+ */
+class ProfilingPanel : public QWidget
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * \brief Time between two collections of the profiler, in milliseconds.
+	 */
+	static constexpr int RefreshInterval = 500;
+
+	explicit ProfilingPanel(QWidget* parent = nullptr);
+	~ProfilingPanel() override = default;
+	Q_DISABLE_COPY_MOVE(ProfilingPanel);
+
+protected:
+	void showEvent(QShowEvent* event) override;
+
+private:
+	/**
+	 * \brief Collects the profiler, and shows its statistics if the panel is visible.
+	 */
+	void Refresh();
+
+	QTableWidget* m_table;
+	QLabel* m_droppedEventsLabel;
+	QPushButton* m_clearBtn;
+	QTimer m_refreshTimer;
+};
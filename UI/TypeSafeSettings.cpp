@@ -1,5 +1,7 @@
 #include "TypeSafeSettings.h"
 #include <QFile>
+#include "../Data/DiskFrameCache.h"
+#include "../Data/FrameCache.h"
 
 TypeSafeSettings::TypeSafeSettings() :
 	m_settings(QSettings::IniFormat, QSettings::UserScope, "maxime_casas", "reference_tracker")
@@ -37,6 +39,57 @@ bool TypeSafeSettings::IsMaximized() const
 	return m_settings.value(IS_MAXIMIZED, false).toBool();
 }
 
+void TypeSafeSettings::SetFrameCacheBudget(const int megabytes)
+{
+	m_settings.setValue(FRAME_CACHE_BUDGET, megabytes);
+}
+
+int TypeSafeSettings::GetFrameCacheBudget() const
+{
+	return m_settings.value(FRAME_CACHE_BUDGET, Data::FrameCache::DefaultBudgetMegabytes).toInt();
+}
+
+void TypeSafeSettings::SetReadAheadFrames(const int frameCount)
+{
+	m_settings.setValue(READ_AHEAD_FRAMES, frameCount);
+}
+
+int TypeSafeSettings::GetReadAheadFrames() const
+{
+	return m_settings.value(READ_AHEAD_FRAMES, 0).toInt();
+}
+
+void TypeSafeSettings::SetDiskCacheEnabled(const bool enabled)
+{
+	m_settings.setValue(DISK_CACHE_ENABLED, enabled);
+}
+
+bool TypeSafeSettings::IsDiskCacheEnabled() const
+{
+	return m_settings.value(DISK_CACHE_ENABLED, false).toBool();
+}
+
+void TypeSafeSettings::SetDiskCacheMaxSize(const int gigabytes)
+{
+	m_settings.setValue(DISK_CACHE_MAX_SIZE, gigabytes);
+}
+
+int TypeSafeSettings::GetDiskCacheMaxSize() const
+{
+	return m_settings.value(DISK_CACHE_MAX_SIZE, Data::DiskFrameCache::DefaultMaxSizeGigabytes).toInt();
+}
+
+void TypeSafeSettings::SetProxyEnabled(const bool enabled)
+{
+	m_settings.setValue(PROXY_ENABLED, enabled);
+}
+
+bool TypeSafeSettings::IsProxyEnabled() const
+{
+	// Opt-in: the proxy is a full transcode of the video, written next to it.
+	return m_settings.value(PROXY_ENABLED, false).toBool();
+}
+
 void TypeSafeSettings::AddRecentVideo(const QString& path)
 {
 	QStringList recentVids = GetRecentVideos();
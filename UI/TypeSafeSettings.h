@@ -17,6 +17,21 @@ public:
 	void SetMaximized(bool maximized);
 	_NODISCARD bool IsMaximized() const;
 
+	void SetFrameCacheBudget(int megabytes);
+	_NODISCARD int GetFrameCacheBudget() const;
+
+	void SetReadAheadFrames(int frameCount);
+	_NODISCARD int GetReadAheadFrames() const;
+
+	void SetDiskCacheEnabled(bool enabled);
+	_NODISCARD bool IsDiskCacheEnabled() const;
+
+	void SetDiskCacheMaxSize(int gigabytes);
+	_NODISCARD int GetDiskCacheMaxSize() const;
+
+	void SetProxyEnabled(bool enabled);
+	_NODISCARD bool IsProxyEnabled() const;
+
 	void AddRecentVideo(const QString& path);
 	_NODISCARD QStringList GetRecentVideos() const;
 
@@ -30,6 +45,11 @@ private:
 	static const inline QString MINIMZED_WIDTH = "MINIMZED_WIDTH";
 	static const inline QString MINIMZED_HEIGHT = "MINIMZED_HEIGHT";
 	static const inline QString IS_MAXIMIZED = "IS_MAXIMIZED";
+	static const inline QString FRAME_CACHE_BUDGET = "FRAME_CACHE_BUDGET";
+	static const inline QString READ_AHEAD_FRAMES = "READ_AHEAD_FRAMES";
+	static const inline QString DISK_CACHE_ENABLED = "DISK_CACHE_ENABLED";
+	static const inline QString DISK_CACHE_MAX_SIZE = "DISK_CACHE_MAX_SIZE";
+	static const inline QString PROXY_ENABLED = "PROXY_ENABLED";
 	static const inline QString RECENT_VIDEOS = "RECENT_VIDEOS";
 	static const inline QString RECENT_PROJECTS = "RECENT_PROJECTS";
 	QSettings m_settings;
@@ -2,7 +2,8 @@
 #include "ui_VideoPlayer.h"
 #include <QPixmap>
 #include <QGraphicsRectItem>
-#include <QDebug>
+#include "../Profiling/Profiler.h"
+#include "../Logging/Log.h"
 
 VideoPlayer::VideoPlayer(Data::Document& document, QWidget* parent) :
 	QWidget(parent),
@@ -49,7 +50,7 @@ VideoPlayer::VideoPlayer(Data::Document& document, QWidget* parent) :
 
 VideoPlayer::~VideoPlayer()
 {
-	qDebug() << "VideoPlayer::~VideoPlayer()";
+	qCDebug(LogUi) << "VideoPlayer::~VideoPlayer()";
 	delete ui;
 }
 
@@ -169,6 +170,8 @@ QPointF VideoPlayer::ScenePosToImagePos(const QPointF& scenePosition) const
 
 void VideoPlayer::Render(const int currentFrame)
 {
+	const Profiling::ScopedTimer timer("VideoPlayer render");
+
 	// 1. Get the image from the video, and perform some additional drawing on top of it (keyframes etc.).
 	const cv::Mat& currentVideoImage = m_video.GetCurrentImage();
 
@@ -178,17 +181,22 @@ void VideoPlayer::Render(const int currentFrame)
 	pixmap.convertFromImage(image);
 
 	// 3. Perform some additional drawing on the Qt image (draw the motion trails).
-	DrawMotionTrails(pixmap, currentFrame);
+	// Preview images are smaller than the video: the drawing is scaled down to match them,
+	// and the displayer scales the result back up to the size of the video.
+	const qreal imageScale = currentVideoImage.cols > 0 ? static_cast<qreal>(currentVideoImage.cols) / static_cast<qreal>(m_video.GetWidth()) : 1.0;
+	DrawMotionTrails(pixmap, currentFrame, imageScale);
 
 	// 4. Put the image
 	m_pixmapDisplayer.setPixmap(pixmap);
+	m_pixmapDisplayer.setScale(1.0 / imageScale);
 }
 
 
-void VideoPlayer::DrawMotionTrails(QPixmap& pixmap, const int currentFrame)
+void VideoPlayer::DrawMotionTrails(QPixmap& pixmap, const int currentFrame, const qreal imageScale)
 {
 	QPainter painter(&pixmap);
 	painter.setRenderHint(QPainter::Antialiasing);
+	painter.scale(imageScale, imageScale);
 
 	const std::vector<std::unique_ptr<Data::TrackedPoint>>& trackedPoints = m_document.GetTrackedPoints();
 
@@ -28,7 +28,7 @@ signals:
 	void ImageClicked(const QPointF& imagePos);
 
 private:
-	void DrawMotionTrails(QPixmap& pixmap, int currentFrame);
+	void DrawMotionTrails(QPixmap& pixmap, int currentFrame, qreal imageScale);
 
 	void PlayBtnClicked();
 	void Play();
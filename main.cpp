@@ -1,6 +1,7 @@
 ﻿#include <QApplication>
 #include <QFile>
 
+#include "Logging/Log.h"
 #include "UI/MainWindow.h"
 
 
@@ -16,6 +17,7 @@ int main(int argc, char** argv)
     Q_INIT_RESOURCE(resources);
 
     QApplication a(argc, argv);
+    const Logging::AsyncLogSink logSink;
 
     // Apply the stylesheet.
     QFile styleFile(":/Resources/style.css");